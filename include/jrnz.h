@@ -0,0 +1,56 @@
+/**
+ * @brief C interface for creating and driving emulated machines in-process.
+ *
+ * Each machine is independent; machines may be run concurrently on different threads, but a single machine must
+ * only be used from one thread at a time. Functions returning int return 0 on success and -1 on failure.
+ */
+
+#ifndef JRNZ_H
+#define JRNZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct jrnz_machine jrnz_machine;
+
+jrnz_machine *jrnz_create(void);
+void jrnz_destroy(jrnz_machine *machine);
+
+/* Model is 48 (the default) or 128, set it before loading the ROM */
+int jrnz_set_model(jrnz_machine *machine, int model);
+
+/* Images are copied, the buffers may be released as soon as the call returns */
+int jrnz_load_rom(jrnz_machine *machine, const uint8_t *data, size_t size);
+int jrnz_load_sna(jrnz_machine *machine, const uint8_t *data, size_t size);
+int jrnz_load_z80(jrnz_machine *machine, const uint8_t *data, size_t size);
+
+/* Returns the number of frames completed, fewer than count if the machine stopped */
+uint32_t jrnz_run_frames(jrnz_machine *machine, uint32_t count);
+uint64_t jrnz_frames_completed(const jrnz_machine *machine);
+
+/* Half-rows are numbered as port 0xfe address bits 8-15, keys are active high in bits 0-4 */
+void jrnz_set_key_row(jrnz_machine *machine, uint8_t row, uint8_t keys);
+
+/* ARGB8888 pixels of the last completed frame including the border, valid until the machine next runs */
+const uint32_t *jrnz_framebuffer(const jrnz_machine *machine, int *width, int *height);
+
+/* Moves up to max buffered samples (signed 16-bit mono, the beeper mixed with the 128K sound chip) into out,
+   returns how many were moved */
+size_t jrnz_read_audio(jrnz_machine *machine, int16_t *out, size_t max);
+uint32_t jrnz_audio_frequency(void);
+
+void jrnz_read_memory(const jrnz_machine *machine, uint16_t addr, uint8_t *out, size_t count);
+
+/* Returns the size of the state; it is only written if out holds at least that many bytes */
+size_t jrnz_save_state(const jrnz_machine *machine, uint8_t *out, size_t max);
+int jrnz_restore_state(jrnz_machine *machine, const uint8_t *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JRNZ_H */
@@ -0,0 +1,116 @@
+/**
+ * @brief Implementation of the audio capture.
+ */
+
+#include "audio_capture.hpp"
+
+#include <iostream>
+
+static void put_u32(std::ofstream &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.put(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+static void put_u16(std::ofstream &out, uint16_t value) {
+    out.put(static_cast<char>(value & 0xff));
+    out.put(static_cast<char>(value >> 8));
+}
+
+bool AudioCapture::open(const std::string &filename, uint32_t _rate) {
+    close();
+
+    out.open(filename, std::ios::binary);
+    if (!out) {
+        std::cerr << "Unable to write audio to \'" << filename << "\'" << std::endl;
+        return false;
+    }
+
+    rate = _rate;
+    data_bytes = 0;
+    wav = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".wav") == 0;
+    if (wav) {
+        // Written again with the sizes filled in when the file is closed
+        write_wav_header();
+    }
+
+    stopping = false;
+    writer = std::thread(&AudioCapture::writer_loop, this);
+    return true;
+}
+
+void AudioCapture::close() {
+    if (!writer.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_ready.notify_one();
+    writer.join();
+
+    if (wav) {
+        out.seekp(0);
+        write_wav_header();
+    }
+    out.close();
+}
+
+void AudioCapture::write(const int16_t *samples, size_t count) {
+    queue_samples(samples, count);
+    if (forward != nullptr) {
+        forward->write(samples, count);
+    }
+}
+
+void AudioCapture::write_muted(const int16_t *samples, size_t count) {
+    queue_samples(samples, count);
+    if (forward != nullptr) {
+        forward->write_muted(samples, count);
+    }
+}
+
+void AudioCapture::queue_samples(const int16_t *samples, size_t count) {
+    if (writer.joinable()) {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue.insert(queue.end(), samples, samples + count);
+    }
+    queue_ready.notify_one();
+}
+
+void AudioCapture::writer_loop() {
+    std::vector<int16_t> block;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_ready.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            // Swap so the emulation thread appends to an empty buffer while this one is written
+            block.swap(queue);
+        }
+
+        out.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(block.size() * 2));
+        data_bytes += block.size() * sizeof(int16_t);
+        block.clear();
+    }
+}
+
+void AudioCapture::write_wav_header() {
+    uint32_t data_size = static_cast<uint32_t>(data_bytes);
+    out.write("RIFF", 4);
+    put_u32(out, 36 + data_size);
+    out.write("WAVEfmt ", 8);
+    put_u32(out, 16);
+    put_u16(out, 1);  // PCM
+    put_u16(out, 1);  // Mono
+    put_u32(out, rate);
+    put_u32(out, rate * 2);
+    put_u16(out, 2);   // Bytes per sample
+    put_u16(out, 16);  // Bits per sample
+    out.write("data", 4);
+    put_u32(out, data_size);
+}
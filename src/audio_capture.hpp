@@ -0,0 +1,67 @@
+/**
+ * @brief Header defining the audio capture used to record output to a file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "machine_io.hpp"
+
+/**
+ * @brief Writes every sample to a WAV file, or to a raw stream of signed 16-bit mono samples in host byte order.
+ * Samples are queued on the emulation thread and written by a thread of its own, so capturing costs the emulation
+ * one short lock per block. Nothing is dropped, the file holds exactly what the beeper produced. WAV data is also
+ * written in host byte order, which is what the format expects on the little-endian hosts this runs on.
+ */
+class AudioCapture : public AudioSink {
+public:
+    AudioCapture() {}
+    virtual ~AudioCapture() { close(); }
+
+    AudioCapture(const AudioCapture &) = delete;
+    AudioCapture &operator=(const AudioCapture &) = delete;
+
+    /**
+     * @brief Start writing to filename, as a WAV file if it ends in .wav and as raw samples otherwise (which suits a
+     * named pipe). rate only goes into the WAV header.
+     */
+    bool open(const std::string &filename, uint32_t rate);
+
+    // Write out everything queued, finish the WAV header and close the file
+    void close();
+
+    void write(const int16_t *samples, size_t count) override;
+    // Recorded but not passed on
+    void write_muted(const int16_t *samples, size_t count) override;
+    float fill() const override { return (forward != nullptr) ? forward->fill() : 0.5f; }
+
+    uint64_t samples_written() const { return data_bytes / sizeof(int16_t); }
+
+    // Samples are passed on to this sink as well, so a run can be heard while it is captured
+    AudioSink *forward = {nullptr};
+
+private:
+    void queue_samples(const int16_t *samples, size_t count);
+    void writer_loop();
+    void write_wav_header();
+
+    std::ofstream out;
+    bool wav = {false};
+    uint32_t rate = {0};
+    std::atomic<uint64_t> data_bytes = {0};
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::vector<int16_t> queue;
+    bool stopping = {false};
+    std::thread writer;
+};
@@ -0,0 +1,215 @@
+/**
+ * @brief Implementation of the AY-3-8912 sound chip and the sample mixing kernels.
+ */
+
+#include "ay.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "beeper.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JRNZ_AY_X86 1
+#endif
+
+// Bits of each register that exist on the chip, the rest read back as zero
+static constexpr std::array<uint8_t, 16> register_masks = {0xff, 0x0f, 0xff, 0x0f, 0xff, 0x0f, 0x1f, 0xff,
+                                                           0x1f, 0x1f, 0x1f, 0xff, 0xff, 0x0f, 0xff, 0xff};
+
+// The DAC is logarithmic, measured levels scaled so three channels and the beeper stay inside int16_t
+static constexpr std::array<int16_t, 16> volume_levels = {0,    82,   123,  175,  254,  371,  508,  821,
+                                                          1015, 1588, 2116, 2699, 3422, 4124, 5089, 6000};
+
+enum EnvelopeShape : uint8_t { HOLD = 0x01, ALTERNATE = 0x02, ATTACK = 0x04, CONTINUE = 0x08 };
+
+void AY::reset() {
+    registers.fill(0);
+    selected = 0;
+    tone_phase = 0;
+    slow_phase = 0;
+    tone_count.fill(0);
+    tone_out.fill(0);
+    noise_count = 0;
+    noise_shift = 1;
+    envelope_count = 0;
+    envelope_step = 0;
+    envelope_attack = false;
+    envelope_holding = false;
+    rendered = 0;
+}
+
+void AY::set_sample_rate(uint32_t rate) {
+    tone_step = static_cast<uint32_t>((uint64_t(clock_hz) << 16) / (uint64_t(8) * rate));
+    slow_step = static_cast<uint32_t>((uint64_t(clock_hz) << 16) / (uint64_t(16) * rate));
+    ultrasonic_period = static_cast<uint16_t>(tone_step >> 16);
+}
+
+void AY::write_data(uint8_t value, uint32_t tstate) {
+    if (selected > 15) {
+        return;
+    }
+
+    // Everything up to now was played with the old register value
+    render(beeper != nullptr ? beeper->sample_position(tstate) : 0);
+
+    registers[selected] = value & register_masks[selected];
+    if (selected == 13) {
+        envelope_count = 0;
+        envelope_step = 0;
+        envelope_attack = (value & ATTACK) != 0;
+        envelope_holding = false;
+    }
+}
+
+uint8_t AY::read_data() const {
+    return (selected > 15) ? 0xff : registers[selected];
+}
+
+void AY::step_envelope() {
+    if (envelope_holding || ++envelope_step < 16) {
+        return;
+    }
+
+    uint8_t shape = registers[13];
+    envelope_step = 15;
+    if (!(shape & CONTINUE)) {
+        // A single ramp then silence
+        envelope_attack = false;
+        envelope_holding = true;
+    } else if (shape & HOLD) {
+        if (shape & ALTERNATE) {
+            envelope_attack = !envelope_attack;
+        }
+        envelope_holding = true;
+    } else {
+        if (shape & ALTERNATE) {
+            envelope_attack = !envelope_attack;
+        }
+        envelope_step = 0;
+    }
+}
+
+void AY::render(size_t until) {
+    until = std::min(until, block.size());
+    for (; rendered < until; rendered++) {
+        tone_phase += tone_step;
+        uint32_t tone_ticks = tone_phase >> 16;
+        tone_phase &= 0xffff;
+        slow_phase += slow_step;
+        uint32_t slow_ticks = slow_phase >> 16;
+        slow_phase &= 0xffff;
+
+        uint16_t noise_period = std::max<uint16_t>(registers[6], 1);
+        for (noise_count += slow_ticks; noise_count >= noise_period; noise_count -= noise_period) {
+            // 17 bit shift register tapped at bits 0 and 3
+            uint32_t bit = (noise_shift ^ (noise_shift >> 3)) & 1;
+            noise_shift = (noise_shift >> 1) | (bit << 16);
+        }
+
+        uint32_t envelope_period = std::max<uint32_t>(registers[11] | (registers[12] << 8u), 1);
+        for (envelope_count += slow_ticks; envelope_count >= envelope_period; envelope_count -= envelope_period) {
+            step_envelope();
+        }
+
+        uint8_t mixer = registers[7];
+        int32_t sample = 0;
+        for (int c = 0; c < 3; c++) {
+            uint16_t period = static_cast<uint16_t>(registers[c * 2] | (registers[c * 2 + 1] << 8));
+            period = std::max<uint16_t>(period, 1);
+            tone_count[c] += tone_ticks;
+            if (tone_count[c] >= period) {
+                tone_out[c] ^= (tone_count[c] / period) & 1;
+                tone_count[c] %= period;
+            }
+
+            // A disabled generator holds its input to the channel high
+            bool noise_high = (mixer & (0x08 << c)) || (noise_shift & 1);
+            if (!noise_high) {
+                continue;
+            }
+
+            uint8_t volume = registers[8 + c];
+            int16_t level = volume_levels[(volume & 0x10) ? envelope_volume() : volume];
+            if (mixer & (0x01 << c)) {
+                sample += level;
+            } else if (period <= ultrasonic_period) {
+                sample += level / 2;
+            } else if (tone_out[c]) {
+                sample += level;
+            }
+        }
+        block[rendered] = static_cast<int16_t>(sample);
+    }
+}
+
+void AY::mix(int16_t *out, size_t count) {
+    render(count);
+    mix_samples(out, block.data(), std::min(count, rendered));
+    rendered = 0;
+}
+
+void AY::save_state(StateWriter &state) const {
+    state.put(registers);
+    state.put(selected);
+    state.put(tone_phase);
+    state.put(slow_phase);
+    state.put(tone_count);
+    state.put(tone_out);
+    state.put(noise_count);
+    state.put(noise_shift);
+    state.put(envelope_count);
+    state.put(envelope_step);
+    state.put(envelope_attack);
+    state.put(envelope_holding);
+    state.put(block);
+    state.put(rendered);
+}
+
+bool AY::load_state(StateReader &state) {
+    state.get(registers);
+    state.get(selected);
+    state.get(tone_phase);
+    state.get(slow_phase);
+    state.get(tone_count);
+    state.get(tone_out);
+    state.get(noise_count);
+    state.get(noise_shift);
+    state.get(envelope_count);
+    state.get(envelope_step);
+    state.get(envelope_attack);
+    state.get(envelope_holding);
+    state.get(block);
+    state.get(rendered);
+    return state.ok() && rendered <= block.size() && envelope_step < 16;
+}
+
+static void mix_samples_scalar(int16_t *out, const int16_t *in, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<int16_t>(std::clamp<int32_t>(out[i] + in[i], INT16_MIN, INT16_MAX));
+    }
+}
+
+#ifdef JRNZ_AY_X86
+__attribute__((target("sse2"))) static void mix_samples_sse2(int16_t *out, const int16_t *in, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(out + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_adds_epi16(a, b));
+    }
+    mix_samples_scalar(out + i, in + i, count - i);
+}
+#endif
+
+void mix_samples(int16_t *out, const int16_t *in, size_t count) {
+#ifdef JRNZ_AY_X86
+    static const bool has_sse2 = __builtin_cpu_supports("sse2");
+    if (has_sse2) {
+        mix_samples_sse2(out, in, count);
+        return;
+    }
+#endif
+    mix_samples_scalar(out, in, count);
+}
@@ -0,0 +1,85 @@
+/**
+ * @brief Header defining the AY-3-8912 sound chip of the 128K.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "beeper.hpp"
+#include "state.hpp"
+
+/**
+ * @brief The AY-3-8912, with three tone channels, a noise generator and an envelope generator.
+ * The chip is selected through port 0xfffd, which also reads back the selected register, and written through 0xbffd.
+ *
+ * Rather than clocking the chip every T-state, its output is generated a sample at a time when the beeper finishes
+ * a frame. A register write first brings the output up to the beeper's sample at that T-state, so the change is
+ * heard at the right point in the frame. Without a beeper the chip has no timing and only keeps its registers.
+ */
+class AY {
+public:
+    // Half the 128K CPU clock
+    static constexpr uint32_t clock_hz = 1773400;
+    // Holds a frame of output
+    static constexpr size_t block_size = Beeper::max_frame_samples;
+
+    AY() { set_sample_rate(Beeper::default_sample_rate); }
+    virtual ~AY() {}
+
+    void reset();
+
+    void select(uint8_t reg) { selected = reg; }
+    // tstate is counted from the start of the frame
+    void write_data(uint8_t value, uint32_t tstate);
+    uint8_t read_data() const;
+
+    /**
+     * @brief Generate the chip's output up to sample count of the current block and add it to out, saturating.
+     * Starts a new block afterwards.
+     */
+    void mix(int16_t *out, size_t count);
+
+    // Set by the beeper the chip is attached to
+    void set_sample_rate(uint32_t rate);
+
+    void save_state(StateWriter &state) const;
+    bool load_state(StateReader &state);
+
+    const Beeper *beeper = {nullptr};
+
+private:
+    void render(size_t until);
+    void step_envelope();
+    uint8_t envelope_volume() const { return envelope_attack ? envelope_step : 15 - envelope_step; }
+
+    std::array<uint8_t, 16> registers = {};
+    uint8_t selected = {0};
+
+    // Tone counters run at clock / 8, noise and envelope counters at clock / 16, both in 16.16 fixed point per sample
+    uint32_t tone_step = {0};
+    uint32_t slow_step = {0};
+    // Tones that toggle more than once a sample are above the output's range, they are heard as their average level
+    uint16_t ultrasonic_period = {0};
+
+    uint32_t tone_phase = {0};
+    uint32_t slow_phase = {0};
+    std::array<uint16_t, 3> tone_count = {};
+    std::array<uint8_t, 3> tone_out = {};
+    uint16_t noise_count = {0};
+    uint32_t noise_shift = {1};
+    uint32_t envelope_count = {0};
+    uint8_t envelope_step = {0};
+    bool envelope_attack = {false};
+    bool envelope_holding = {false};
+
+    std::array<int16_t, block_size> block = {};
+    size_t rendered = {0};
+};
+
+/**
+ * @brief Add count samples from in to out, saturating at the limits of int16_t. Uses SSE2 where the host has it.
+ */
+void mix_samples(int16_t *out, const int16_t *in, size_t count);
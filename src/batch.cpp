@@ -0,0 +1,186 @@
+/**
+ * @brief Implementation of the batch runner.
+ */
+
+#include "batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "frame_dump.hpp"
+
+bool parse_frame_count(const std::string &text, uint64_t &frames) {
+    // strtoull accepts a sign and wraps negative numbers round
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    frames = strtoull(text.c_str(), &end, 0);
+    return *end == '\0' && errno == 0 && frames <= UINT32_MAX;
+}
+
+bool read_batch_jobs(std::istream &in, uint64_t default_frames, std::vector<BatchJob> &jobs) {
+    std::string line;
+    size_t line_no = 0;
+
+    while (std::getline(in, line)) {
+        line_no++;
+
+        std::istringstream fields(line);
+        BatchJob job;
+        if (!(fields >> job.file) || job.file[0] == '#') {
+            continue;
+        }
+
+        job.frames = default_frames;
+        std::string frames;
+        if (fields >> frames) {
+            if (!parse_frame_count(frames, job.frames)) {
+                std::cerr << "Bad frame count \'" << frames << "\' on line " << line_no << " of the job list\n";
+                return false;
+            }
+        }
+
+        job.index = jobs.size();
+        jobs.push_back(job);
+    }
+
+    return true;
+}
+
+bool load_snapshot_file(Machine &machine, const std::string &file, std::string &error) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        error = "unable to open file";
+        return false;
+    }
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::string extension = file.substr(file.find_last_of('.') + 1);
+    for (char &ch : extension) {
+        ch = static_cast<char>(tolower(ch));
+    }
+
+    bool loaded = false;
+    if (extension == "sna") {
+        loaded = machine.load_sna(image.data(), image.size());
+    } else if (extension == "z80") {
+        loaded = machine.load_z80(image.data(), image.size());
+    } else {
+        error = "unknown snapshot type";
+        return false;
+    }
+
+    if (!loaded) {
+        error = "unsupported or damaged snapshot";
+    }
+    return loaded;
+}
+
+std::string json_string(const std::string &value) {
+    std::stringstream out;
+    out << '"';
+    for (char ch : value) {
+        if (ch == '"' || ch == '\\') {
+            out << '\\' << ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(ch) << std::dec;
+        } else {
+            out << ch;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+std::string batch_result_json(const BatchResult &result) {
+    std::stringstream out;
+    out << "{\"job\": " << result.index << ", \"file\": " << json_string(result.file)
+        << ", \"status\": " << json_string(result.status);
+    if (!result.error.empty()) {
+        out << ", \"error\": " << json_string(result.error);
+    }
+    out << ", \"frames\": " << result.frames << std::hex << std::setfill('0') << ", \"frame_hash\": \""
+        << std::setw(16) << result.frame_hash << "\", \"ram_hash\": \"" << std::setw(16) << result.ram_hash
+        << "\", \"pc\": \"0x" << std::setw(4) << result.pc << "\"" << std::dec << std::fixed << std::setprecision(3)
+        << ", \"ms\": " << result.milliseconds << "}";
+    return out.str();
+}
+
+BatchRunner::BatchRunner(const std::vector<uint8_t> &_rom, size_t _threads) : rom(_rom), num_threads(_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+BatchResult BatchRunner::run_job(const BatchJob &job) const {
+    auto start = std::chrono::steady_clock::now();
+
+    BatchResult result;
+    result.index = job.index;
+    result.file = job.file;
+
+    Machine machine;
+    machine.set_model(model);
+    if (!rom.empty()) {
+        machine.load_rom(rom.data(), rom.size());
+    }
+
+    if (!load_snapshot_file(machine, job.file, result.error)) {
+        result.status = "error";
+    } else {
+        // Job lists are checked for counts a machine cannot run, any other job is cut short and reported stopped
+        result.frames = machine.run_frames(static_cast<uint32_t>(std::min<uint64_t>(job.frames, UINT32_MAX)));
+        result.status = (result.frames == job.frames) ? "ok" : "stopped";
+        result.frame_hash = FrameDumper::hash(machine.framebuffer(), ULA::frame_width * ULA::frame_height);
+        result.ram_hash = machine.memory_hash();
+        result.pc = machine.cpu().pc.get();
+
+        if (!screenshot_prefix.empty()) {
+            std::stringstream filename;
+            filename << screenshot_prefix << std::setw(6) << std::setfill('0') << job.index << ".ppm";
+            FrameDumper::write_ppm(filename.str(), machine.framebuffer(), ULA::frame_width, ULA::frame_height);
+        }
+    }
+
+    result.milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void BatchRunner::run(const std::vector<BatchJob> &jobs, const ResultCallback &done) {
+    // Jobs vary a lot in cost, so workers take the next job as they finish rather than a fixed share
+    std::atomic<size_t> next_job = {0};
+    std::mutex done_mutex;
+
+    auto worker = [&]() {
+        for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+            BatchResult result = run_job(jobs[i]);
+
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done(result);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t count = std::min(num_threads, jobs.size());
+    for (size_t i = 1; i < count; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+
+    for (auto &thread : workers) {
+        thread.join();
+    }
+}
@@ -0,0 +1,94 @@
+/**
+ * @brief Header defining the batch runner that plays many snapshots in headless machines.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "machine.hpp"
+
+/**
+ * @brief One snapshot to run for a number of frames.
+ */
+struct BatchJob {
+    size_t index = {0};
+    std::string file;
+    // At most UINT32_MAX
+    uint64_t frames = {0};
+};
+
+/**
+ * @brief Outcome of a job. status is "ok", "error" when the snapshot could not be loaded or "stopped" when the
+ * machine stopped (e.g. on an unknown opcode) before running all of its frames.
+ */
+struct BatchResult {
+    size_t index = {0};
+    std::string file;
+    std::string status;
+    std::string error;
+    uint64_t frames = {0};
+    uint64_t frame_hash = {0};
+    uint64_t ram_hash = {0};
+    uint16_t pc = {0};
+    double milliseconds = {0.0};
+};
+
+/**
+ * @brief Parse a whole string as a frame count, at most the UINT32_MAX frames a machine runs in one call.
+ */
+bool parse_frame_count(const std::string &text, uint64_t &frames);
+
+/**
+ * @brief Read a job list of "<file> [frames]" lines. Blank lines and lines starting with '#' are skipped and jobs
+ * without a frame count run for default_frames.
+ */
+bool read_batch_jobs(std::istream &in, uint64_t default_frames, std::vector<BatchJob> &jobs);
+
+/**
+ * @brief Load a .sna or .z80 snapshot file into a machine, chosen by the file extension.
+ */
+bool load_snapshot_file(Machine &machine, const std::string &file, std::string &error);
+
+/**
+ * @brief Quote and escape a string for JSON output.
+ */
+std::string json_string(const std::string &value);
+
+/**
+ * @brief Format a result as a single line of JSON (without the newline).
+ */
+std::string batch_result_json(const BatchResult &result);
+
+/**
+ * @brief Runs jobs on a pool of threads, each job in a machine of its own.
+ * The ROM image is shared read-only between the workers. Results are reported as each job finishes, so they are not
+ * in job order; the callback is never called from two threads at once.
+ */
+class BatchRunner {
+public:
+    using ResultCallback = std::function<void(const BatchResult &)>;
+
+    BatchRunner(const std::vector<uint8_t> &_rom, size_t _threads);
+    virtual ~BatchRunner() {}
+
+    void run(const std::vector<BatchJob> &jobs, const ResultCallback &done);
+
+    BatchResult run_job(const BatchJob &job) const;
+
+    size_t threads() const { return num_threads; }
+
+    // Write the last frame of each job to <prefix><index>.ppm
+    std::string screenshot_prefix = {""};
+
+    SpectrumModel model = {SpectrumModel::ZX48K};
+
+private:
+    const std::vector<uint8_t> &rom;
+    size_t num_threads;
+};
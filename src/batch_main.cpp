@@ -0,0 +1,77 @@
+/**
+ * @brief Entry point of jrnz-batch, which runs a list of snapshots in headless machines on all host cores.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "batch.hpp"
+#include "batch_options.hpp"
+
+int main(int argc, char **argv) {
+    BatchOptions options(argc, argv);
+
+    if (!options.jobs_on) {
+        std::cerr << "No job list given, see --help\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream jobs_in(options.jobs_file);
+    if (!jobs_in) {
+        std::cerr << "No job list found called \'" << options.jobs_file << "\'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<BatchJob> jobs;
+    if (!read_batch_jobs(jobs_in, options.frames, jobs)) {
+        return EXIT_FAILURE;
+    }
+
+    // Read once and shared by every worker
+    std::vector<uint8_t> rom;
+    if (options.rom_on) {
+        std::ifstream rom_in(options.rom_file, std::ios::binary);
+        if (!rom_in) {
+            std::cerr << "No ROM file found called " << options.rom_file << std::endl;
+            return EXIT_FAILURE;
+        }
+        rom.assign(std::istreambuf_iterator<char>(rom_in), std::istreambuf_iterator<char>());
+    }
+
+    std::ofstream output_file;
+    if (options.output_on) {
+        output_file.open(options.output_file);
+        if (!output_file) {
+            std::cerr << "Unable to write results to \'" << options.output_file << "\'" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream &output = options.output_on ? output_file : std::cout;
+
+    BatchRunner runner(rom, options.threads);
+    if (options.screenshots_on) {
+        runner.screenshot_prefix = options.screenshot_prefix;
+    }
+    if (options.model_128k) {
+        runner.model = SpectrumModel::ZX128K;
+    }
+
+    size_t failed = 0;
+    uint64_t frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    runner.run(jobs, [&](const BatchResult &result) {
+        output << batch_result_json(result) << "\n";
+        failed += (result.status != "ok") ? 1 : 0;
+        frames += result.frames;
+    });
+    output.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << jobs.size() << " jobs (" << failed << " failed), " << frames << " frames in " << seconds << "s on "
+              << runner.threads() << " threads, " << (seconds > 0 ? frames / seconds : 0) << " frames/s\n";
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,99 @@
+/**
+ * @brief Source file implementing the batch runner options class.
+ */
+
+#include "batch_options.hpp"
+
+#include <getopt.h>
+
+#include <cstdlib>
+#include <iostream>
+
+#include "batch.hpp"
+
+void BatchOptions::print_help() {
+    std::cout << "Run: " << m_argv[0] << " --jobs <filename> [--rom <filename>] [--output <filename>]\n";
+    std::cout << "\t--help                 - displays this help\n";
+    std::cout << "\t--jobs <filename>      - Job list, one \"<snapshot> [frames]\" per line (.sna or .z80)\n";
+    std::cout << "\t--rom <filename>       - Loads the specified ROM file into every machine (at address 0)\n";
+    std::cout << "\t--output <filename>    - Write one line of JSON per job to <filename> instead of stdout\n";
+    std::cout << "\t--frames <n>           - Frames to run jobs that do not give a count (default 250)\n";
+    std::cout << "\t--threads <n>          - Number of worker threads (default one per core)\n";
+    std::cout << "\t--screenshots <prefix> - Write the last frame of each job to <prefix>NNNNNN.ppm\n";
+    std::cout << "\t--model <48|128>       - Machine to emulate (default 48), the 128 needs its 32K ROM\n";
+    exit(EXIT_SUCCESS);
+}
+
+void BatchOptions::process() {
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},          {"rom", required_argument, 0, 'r'},
+        {"jobs", required_argument, 0, 'j'},    {"output", required_argument, 0, 'o'},
+        {"frames", required_argument, 0, 'n'},  {"threads", required_argument, 0, 't'},
+        {"screenshots", required_argument, 0, 's'}, {"model", required_argument, 0, 'm'},
+        {0, 0, 0, 0}};
+
+    int c;
+
+    while (1) {
+        int option_index = 0;
+
+        c = getopt_long(m_argc, m_argv, "hr:j:o:n:t:s:m:", long_options, &option_index);
+
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+            case 'h': {
+                print_help();
+                break;
+            }
+
+            case 'r': {
+                rom_file = optarg;
+                rom_on = true;
+                break;
+            }
+
+            case 'j': {
+                jobs_file = optarg;
+                jobs_on = true;
+                break;
+            }
+
+            case 'o': {
+                output_file = optarg;
+                output_on = true;
+                break;
+            }
+
+            case 'n': {
+                if (!parse_frame_count(optarg, frames)) {
+                    std::cerr << "Frames should be a count of up to 4294967295\n";
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+
+            case 't': {
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            }
+
+            case 's': {
+                screenshot_prefix = optarg;
+                screenshots_on = true;
+                break;
+            }
+
+            case 'm': {
+                if (std::string(optarg) != "48" && std::string(optarg) != "128") {
+                    std::cerr << "Model should be 48 or 128\n";
+                    exit(EXIT_FAILURE);
+                }
+                model_128k = (std::string(optarg) == "128");
+                break;
+            }
+        }
+    }
+}
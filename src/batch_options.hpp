@@ -0,0 +1,43 @@
+/**
+ * @brief Header file handling the batch runner options.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Defines batch options class.
+ */
+class BatchOptions {
+public:
+    BatchOptions(int argc, char **argv) : m_argc(argc), m_argv(argv) { process(); }
+    ~BatchOptions() {}
+
+    std::string rom_file = {""};
+    bool rom_on = {false};
+
+    std::string jobs_file = {""};
+    bool jobs_on = {false};
+
+    std::string output_file = {""};
+    bool output_on = {false};  // Results go to stdout otherwise
+
+    uint64_t frames = {250};
+    size_t threads = {0};  // 0 uses one thread per host core
+
+    std::string screenshot_prefix = {""};
+    bool screenshots_on = {false};
+
+    bool model_128k = {false};
+
+private:
+    BatchOptions() = delete;
+
+    void print_help();
+    void process();
+
+    int m_argc;
+    char **m_argv;
+};
@@ -0,0 +1,147 @@
+/**
+ * @brief Implementation of the band-limited beeper synthesis.
+ */
+
+#include "beeper.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ay.hpp"
+
+namespace {
+constexpr size_t kernel_phases = 64;
+
+/**
+ * @brief Band-limited impulses for each fraction of a sample a step can fall at.
+ * A Blackman windowed sinc cut off a little below the Nyquist frequency. Each phase is scaled to sum to one, so a
+ * step always settles at exactly its height.
+ */
+struct ImpulseTable {
+    ImpulseTable() {
+        constexpr double cutoff = 0.45;  // Cycles per sample
+        constexpr double width = Beeper::kernel_width;
+        const double pi = std::acos(-1.0);
+
+        for (size_t p = 0; p < kernel_phases; p++) {
+            double fraction = static_cast<double>(p) / kernel_phases;
+            double total = 0;
+            std::array<double, Beeper::kernel_width> phase = {};
+            for (size_t j = 0; j < Beeper::kernel_width; j++) {
+                double x = static_cast<double>(j) - fraction - width / 2;
+                double sinc = (x == 0) ? 1.0 : std::sin(2 * pi * cutoff * x) / (2 * pi * cutoff * x);
+                double w = (x + width / 2) / width;
+                double window = std::max(0.0, 0.42 - 0.5 * std::cos(2 * pi * w) + 0.08 * std::cos(4 * pi * w));
+                phase[j] = sinc * window;
+                total += phase[j];
+            }
+            for (size_t j = 0; j < Beeper::kernel_width; j++) {
+                taps[p][j] = static_cast<float>(phase[j] / total);
+            }
+        }
+    }
+
+    std::array<std::array<float, Beeper::kernel_width>, kernel_phases> taps;
+};
+
+const ImpulseTable impulse_table;
+}  // namespace
+
+void Beeper::set_sample_rate(uint32_t _rate) {
+    nominal_rate = std::clamp<uint32_t>(_rate, 8000, max_sample_rate);
+    rate = nominal_rate;
+    average_fill = 0.5f;
+    carry = 0;
+    if (ay != nullptr) {
+        ay->set_sample_rate(rate);
+    }
+}
+
+void Beeper::attach_sound_chip(AY *chip) {
+    if (ay != nullptr) {
+        ay->beeper = nullptr;
+    }
+    ay = chip;
+    if (ay != nullptr) {
+        ay->beeper = this;
+        ay->set_sample_rate(rate);
+    }
+}
+
+void Beeper::add_step(uint32_t tstate, float delta) {
+    // Position in samples from the start of the frame, in units of 1 / cpu_clock_hz of a sample
+    uint64_t position = carry + uint64_t(tstate) * rate;
+    size_t index = std::min<size_t>(position / cpu_clock_hz, max_frame_samples - 1);
+    size_t phase = static_cast<size_t>((position % cpu_clock_hz) * kernel_phases / cpu_clock_hz);
+
+    // The impulse is centred half the kernel after the step, delaying the output by that much
+    const std::array<float, kernel_width> &taps = impulse_table.taps[phase];
+    for (size_t j = 0; j < kernel_width; j++) {
+        impulses[index + j] += delta * taps[j];
+    }
+}
+
+void Beeper::end_frame(uint32_t tstates) {
+    if (audio == nullptr) {
+        return;
+    }
+    HOST_PROFILE_SCOPE(host_profiler, Beeper);
+
+    uint64_t total = carry + uint64_t(tstates) * rate;
+    size_t count = std::min<size_t>(total / cpu_clock_hz, max_frame_samples);
+    carry = total - uint64_t(count) * cpu_clock_hz;
+
+    for (size_t i = 0; i < count; i++) {
+        sum += impulses[i];
+        samples[i] = static_cast<int16_t>(std::clamp(std::lrint(sum), -32768L, 32767L));
+    }
+
+    // Keep the impulses spilling into the next frame
+    std::copy(impulses.begin() + count, impulses.begin() + count + kernel_width, impulses.begin());
+    std::fill(impulses.begin() + kernel_width, impulses.begin() + count + kernel_width, 0.0f);
+    if (std::all_of(impulses.begin(), impulses.begin() + kernel_width, [](float v) { return v == 0.0f; })) {
+        // Nothing left to settle, so drop any rounding the running sum has picked up
+        sum = static_cast<float>(level);
+    }
+
+    if (ay != nullptr) {
+        ay->mix(samples.data(), count);
+    }
+    if (muted) {
+        audio->write_muted(samples.data(), count);
+        return;
+    }
+    audio->write(samples.data(), count);
+
+    // The sink drains at its own clock, produce a little more when it runs low and a little less when it fills up.
+    // The fill level is smoothed because the sink takes samples in bursts.
+    average_fill += (audio->fill() - average_fill) * 0.1f;
+    float skew = std::clamp(1.0f - 2.0f * average_fill, -1.0f, 1.0f) * max_rate_skew;
+    uint32_t skewed = static_cast<uint32_t>(std::lrint(nominal_rate * (1.0f + skew)));
+    if (skewed != rate) {
+        rate = std::min(skewed, max_sample_rate);
+        if (ay != nullptr) {
+            ay->set_sample_rate(rate);
+        }
+    }
+}
+
+void Beeper::set_cpu_clock(uint32_t hz) {
+    cpu_clock_hz = hz;
+    carry = 0;
+}
+
+void Beeper::save_state(StateWriter &state) const {
+    state.put(level);
+    state.put(carry);
+    state.put(impulses);
+    state.put(sum);
+}
+
+bool Beeper::load_state(StateReader &state) {
+    state.get(level);
+    state.get(carry);
+    state.get(impulses);
+    state.get(sum);
+    return state.ok() && carry < cpu_clock_hz;
+}
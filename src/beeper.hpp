@@ -4,121 +4,100 @@
 
 #pragma once
 
-#include <SDL2/SDL_audio.h>
-
 #include <array>
-#include <cmath>
-#include <fstream>
-#include <string>
+#include <cstddef>
+#include <cstdint>
 
 #include "common.hpp"
+#include "host_profiler.hpp"
+#include "machine_io.hpp"
+#include "state.hpp"
 
-// Varying the number of buffers is a balance between improving the quality of the output but increasing the delay in
-// output
-constexpr uint32_t num_buffers = 4;
-constexpr uint16_t frequency = 22050;
-constexpr uint32_t num_clocks_per_sample = static_cast<int>(3500000 / frequency) + 1;
-constexpr uint16_t samples = num_clocks_per_sample * 4;
+class AY;
 
 /**
  * @brief Class describing the beeper
- * This class assumes the SDL audio is already initialized.
+ * The beeper is driven by the level changes written to port 0xfe rather than by every T-state. Each change is added
+ * to the frame's output as a band-limited step, and the frame's samples are produced when the ULA finishes it, so
+ * the cost follows the number of edges and the output does not alias. Without an audio sink the beeper is silent.
+ * The rate is steered slightly by how full the sink's queue is, so audio keeps pace with the host's frame timing.
+ * When a sound chip is attached its output is mixed into each frame before it is handed to the sink.
  */
 class Beeper {
 public:
-    Beeper() {
-        SDL_zero(audiospec);
-        audiospec.freq = frequency;
-        audiospec.format = AUDIO_S8;
-        audiospec.channels = 1;
-        audiospec.samples = samples;
-        audiospec.callback = Beeper::audio_callback;
-        audiospec.userdata = reinterpret_cast<void *>(this);
-
-        device = SDL_OpenAudioDevice(nullptr, 0, &audiospec, nullptr, 0);
-        if (device == 0) {
-            std::cerr << "Failed to initialize the audio device\n";
-        } else {
-            SDL_PauseAudioDevice(device, 0);
-            std::cout << "Audio initialized\n";
-        }
-    }
-    virtual ~Beeper() {
-        if (device != 0) {
-            SDL_CloseAudioDevice(device);
+    static constexpr uint32_t default_cpu_clock_hz = 3500000;
+    static constexpr uint32_t default_sample_rate = 44100;
+    static constexpr uint32_t max_sample_rate = 96000;
+    // Enough for the longest frame at the highest sample rate
+    static constexpr size_t max_frame_samples = 2048;
+    // Samples each band-limited step is spread over
+    static constexpr size_t kernel_width = 16;
+    // Furthest the rate is moved from the nominal one to keep the sink's queue half full, far too little to hear
+    static constexpr float max_rate_skew = 0.005f;
+
+    Beeper() {}
+    virtual ~Beeper() {}
+
+    void set_sample_rate(uint32_t _rate);
+    uint32_t sample_rate() const { return nominal_rate; }
+    // Rate samples are currently produced at, within max_rate_skew of the nominal rate
+    uint32_t output_rate() const { return rate; }
+
+    // T-states per second of the model, which sets how many samples a frame makes
+    void set_cpu_clock(uint32_t hz);
+    uint32_t cpu_clock() const { return cpu_clock_hz; }
+
+    /**
+     * @brief Called for every write to port 0xfe, tstate counted from the start of the frame.
+     */
+    void write_port(uint32_t tstate, uint8_t value) {
+        int32_t new_level = port_levels[(value >> 3) & 0x3];
+        if (new_level != level && audio != nullptr) {
+            add_step(tstate, static_cast<float>(new_level - level));
         }
+        level = new_level;
     }
 
-    static void audio_callback(void *userdata, Uint8 *stream, int len) {
-        Beeper *bpr = reinterpret_cast<Beeper *>(userdata);
-        if (bpr->buffer_read_ready) {
-            if (len != samples) {
-                fprintf(stderr, "Reading just %d bytes instead of %d\n", len, samples);
-            }
-            std::memcpy(reinterpret_cast<void *>(stream), reinterpret_cast<void *>(&bpr->data[bpr->buffer_read][0]),
-                        len);
-            bpr->buffer_read = (bpr->buffer_read + 1) % num_buffers;
-            if (bpr->buffer_read == bpr->buffer_write) {
-                // If we have caught up with the write buffer then we should stop reading until told to do so
-                bpr->buffer_read_ready = false;
-            }
-        } else {
-            std::memset(reinterpret_cast<void *>(stream), 0x0, len);
-        }
-    }
+    /**
+     * @brief Produce the samples of a frame tstates long and hand them to the audio sink.
+     */
+    void end_frame(uint32_t tstates);
 
-    void clock(bool is_ear_on, bool is_mic_on, uint64_t clocks) {
-        if (clocks > 0) {
-            num_clocks += clocks;
-
-            if (is_ear_on) {
-                value += 2;
-            } else if (is_ear_on && is_mic_on) {
-                // Both on should make the sound a bit louder
-                value += 4;
-            }
-
-            if (num_clocks > num_clocks_per_sample) {
-                if (value > 0x7f) {
-                    value = 0x7f;
-                }
-                SDL_LockAudioDevice(device);
-
-                data[buffer_write][index++] = value;
-                if (index >= samples) {
-                    // Reached the end of the current data buffer
-                    // Move on to next buffer and mark previous buffer as ready to read
-                    index = 0;
-                    if (!buffer_read_ready) {
-                        // If the buffer were not being read from then mark buffer as read ready
-                        // before moving along to the next one
-                        buffer_read = buffer_write;
-                        buffer_read_ready = true;
-                    }
-                    buffer_write = (buffer_write + 1) % num_buffers;
-                }
-                SDL_UnlockAudioDevice(device);
-                num_clocks -= num_clocks_per_sample;
-                if (num_clocks > 0 && is_ear_on) {
-                    value = 2;
-                } else {
-                    value = 0;
-                }
-            }
-        }
+    // Sample of the current frame being played at tstate
+    size_t sample_position(uint32_t tstate) const {
+        return static_cast<size_t>((carry + uint64_t(tstate) * rate) / cpu_clock_hz);
     }
 
-    uint32_t buffer_read = {0xffffffff};
-    bool buffer_read_ready = {false};
-    uint32_t buffer_write = {0};
-    uint32_t index = {0};
-    uint32_t value = {0};
+    void attach_sound_chip(AY *chip);
 
-    std::array<std::array<char, samples>, num_buffers> data;
+    void save_state(StateWriter &state) const;
+    bool load_state(StateReader &state);
+
+    AudioSink *audio = {nullptr};
+    // Samples are still produced but passed to the sink's write_muted(), used while running faster than real time
+    bool muted = {false};
+    HostProfiler *host_profiler = {nullptr};
 
 private:
-    uint64_t num_clocks = {0};
+    // Speaker levels for MIC (bit 3) and EAR (bit 4), in proportion to the voltages the ULA puts out
+    static constexpr std::array<int32_t, 4> port_levels = {0, 774, 7840, 8128};
+
+    void add_step(uint32_t tstate, float delta);
+
+    AY *ay = {nullptr};
+    uint32_t cpu_clock_hz = {default_cpu_clock_hz};
+    uint32_t nominal_rate = {default_sample_rate};
+    uint32_t rate = {default_sample_rate};
+    float average_fill = {0.5f};
+
+    int32_t level = {0};
+    // Remainder of T-states times sample rate left over from earlier frames
+    uint64_t carry = {0};
+
+    // Steps are added as band-limited impulses and summed as the samples are produced. The extra room holds impulses
+    // that spill over into the next frame.
+    std::array<float, max_frame_samples + kernel_width> impulses = {};
+    float sum = {0};
 
-    SDL_AudioSpec audiospec;
-    SDL_AudioDeviceID device;
+    std::array<int16_t, max_frame_samples> samples = {};
 };
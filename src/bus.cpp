@@ -4,20 +4,306 @@
 
 #include "bus.hpp"
 
+#include <algorithm>
+#include <iterator>
+
 #include "z80.hpp"
 
+Bus::Bus(size_t size) {
+    // Every page starts out sharing the same zeroed page and is copied when first written
+    std::shared_ptr<Page> zero = std::make_shared<Page>();
+    zero->fill(0);
+    pages.assign(bank_page(bank_count), zero);
+    page_owned.assign(pages.size(), false);
+
+    size_t slots = size / page_size;
+    assert(slots <= 0x10000 / page_size);
+    slot_page.assign(slots, 0);
+    page_read.assign(slots, nullptr);
+    page_write.assign(slots, nullptr);
+    slot_hooked.assign(slots, false);
+    map_pages();
+    mark_screen_dirty();
+}
+
+void Bus::fork_from(Bus &parent) {
+    // Both sides must copy a page before writing to it from now on
+    pages = parent.pages;
+    page_owned.assign(pages.size(), false);
+    parent.page_owned.assign(parent.pages.size(), false);
+
+    ram_start = parent.ram_start;
+    machine_model = parent.machine_model;
+    port_7ffd = parent.port_7ffd;
+    port_254 = parent.port_254;
+    floating_counter = parent.floating_counter;
+    frame_tstate = parent.frame_tstate;
+    screen_log_entries = parent.screen_log_entries;
+    resolved = parent.resolved;
+    dirty_rows = parent.dirty_rows;
+    screen_reset = parent.screen_reset;
+
+    map_pages();
+    parent.update_slots();
+}
+
+void Bus::set_model(SpectrumModel model) {
+    machine_model = model;
+    reset_paging(0);
+    mark_screen_dirty();
+}
+
+void Bus::map_pages() {
+    bool paged = (machine_model == SpectrumModel::ZX128K);
+    size_t rom = paged ? ((port_7ffd >> 4) & 0x1) : 0;
+    size_t top_bank = paged ? (port_7ffd & 0x7) : 0;
+    screen_page = bank_page((paged && (port_7ffd & 0x08)) ? 7 : 5);
+
+    const size_t slot_base[4] = {rom_page(rom), bank_page(5), bank_page(2), bank_page(top_bank)};
+    for (size_t slot = 0; slot < slot_page.size(); slot++) {
+        slot_page[slot] = static_cast<uint16_t>(slot_base[slot / bank_pages] + (slot % bank_pages));
+    }
+    update_slots();
+}
+
+void Bus::write_paging(uint8_t v) {
+    // Bits 0-2 select the RAM bank at 0xc000, bit 3 the screen, bit 4 the ROM and bit 5 locks paging until reset
+    if (port_7ffd & 0x20) {
+        return;
+    }
+
+    bool screen_switched = ((port_7ffd ^ v) & 0x08) != 0;
+    if (screen_switched) {
+        // Logged writes refer to the screen being replaced
+        resolve_screen_log();
+    }
+    port_7ffd = v;
+    map_pages();
+    if (screen_switched) {
+        mark_screen_dirty();
+    }
+}
+
+void Bus::reset_paging(uint8_t v) {
+    port_7ffd = v;
+    map_pages();
+}
+
+void Bus::make_private(size_t page) {
+    // Always copy rather than trusting use_count(), which another thread may be changing
+    pages[page] = std::make_shared<Page>(*pages[page]);
+    page_owned[page] = true;
+    for (size_t slot = 0; slot < slot_page.size(); slot++) {
+        if (slot_page[slot] == page) {
+            update_slot(slot);
+        }
+    }
+}
+
+void Bus::update_slot(size_t slot) {
+    size_t page = slot_page[slot];
+    uint32_t first = static_cast<uint32_t>(slot << page_shift);
+    uint32_t last = first + page_size - 1;
+    bool is_screen = page >= screen_page && page < screen_page + screen_pages;
+
+    page_read[slot] = pages[page]->data();
+    if (last < ram_start) {
+        page_write[slot] = rom_sink.data();
+    } else if (first < ram_start || is_screen || slot_hooked[slot] || !page_owned[page]) {
+        page_write[slot] = nullptr;
+    } else {
+        page_write[slot] = pages[page]->data();
+    }
+}
+
+void Bus::update_slots() {
+    for (size_t slot = 0; slot < slot_page.size(); slot++) {
+        update_slot(slot);
+    }
+}
+
+void Bus::set_ram_start(uint16_t addr) {
+    ram_start = addr;
+    update_slots();
+}
+
+void Bus::write_slow(uint16_t addr, uint8_t v) {
+    if (addr < ram_start) {
+        return;
+    }
+
+    // Logged screen writes are resolved lazily, so earlier entries must be read back before this one lands
+    size_t page = slot_page[addr >> page_shift];
+    if (page - screen_page < screen_pages) {
+        mark_dirty(static_cast<uint16_t>(((page - screen_page) << page_shift) | (addr & page_mask)));
+    }
+    writable_page(page)[addr & page_mask] = v;
+    if (slot_hooked[addr >> page_shift]) {
+        for (const WriteHook &hook : write_hooks) {
+            if (addr >= hook.start && addr <= hook.end) {
+                hook.hook->memory_written(addr, v);
+            }
+        }
+    }
+}
+
+StorageElement Bus::deferred_element(uint16_t addr, size_t count) {
+    assert(deferred_count < deferred.size());
+    DeferredElement &element = deferred[deferred_count++];
+    element.addr = addr;
+    element.count = count;
+    element.written = false;
+    for (size_t i = 0; i < count; i++) {
+        element.data[i] = read_data(static_cast<uint16_t>(addr + i));
+    }
+    StorageElement result(element.data, count);
+    result.track_writes(&element.written);
+    return result;
+}
+
+void Bus::write_deferred() {
+    // Only elements the instruction stored to are written, so reading the screen or ROM does not count as a write,
+    // while storing the value already there still reaches the write hooks
+    for (size_t i = 0; i < deferred_count; i++) {
+        const DeferredElement &element = deferred[i];
+        if (!element.written) {
+            continue;
+        }
+        for (size_t j = 0; j < element.count; j++) {
+            write_data(static_cast<uint16_t>(element.addr + j), element.data[j]);
+        }
+    }
+    deferred_count = 0;
+}
+
+void Bus::add_write_hook(uint16_t start, size_t count, MemoryWriteHook *hook) {
+    if (count == 0) {
+        return;
+    }
+    uint32_t end = std::min<uint32_t>(start + static_cast<uint32_t>(count) - 1, 0xffff);
+    write_hooks.push_back(WriteHook{start, end, hook});
+    for (uint32_t slot = start >> page_shift; slot <= (end >> page_shift); slot++) {
+        slot_hooked[slot] = true;
+        update_slot(slot);
+    }
+}
+
+void Bus::remove_write_hook(MemoryWriteHook *hook) {
+    write_hooks.erase(std::remove_if(write_hooks.begin(), write_hooks.end(),
+                                     [hook](const WriteHook &h) { return h.hook == hook; }),
+                      write_hooks.end());
+
+    // Slots stay on the slow path only while another hook covers them
+    for (size_t slot = 0; slot < slot_page.size(); slot++) {
+        uint32_t first = static_cast<uint32_t>(slot << page_shift);
+        uint32_t last = first + page_size - 1;
+        slot_hooked[slot] = std::any_of(write_hooks.begin(), write_hooks.end(), [first, last](const WriteHook &h) {
+            return h.start <= last && h.end >= first;
+        });
+        update_slot(slot);
+    }
+}
+
+void Bus::read_block(uint16_t addr, uint8_t *out, size_t count) const {
+    while (count > 0) {
+        size_t offset = addr & page_mask;
+        size_t chunk = std::min(count, page_size - offset);
+        std::copy_n(page_read[addr >> page_shift] + offset, chunk, out);
+        out += chunk;
+        count -= chunk;
+        addr = static_cast<uint16_t>(addr + chunk);
+    }
+}
+
+void Bus::load_block(uint16_t addr, const uint8_t *data, size_t count) {
+    while (count > 0) {
+        size_t offset = addr & page_mask;
+        size_t chunk = std::min(count, page_size - offset);
+        std::copy_n(data, chunk, writable_slot(addr) + offset);
+        data += chunk;
+        count -= chunk;
+        addr = static_cast<uint16_t>(addr + chunk);
+    }
+}
+
+void Bus::load_bank(uint8_t bank, const uint8_t *data, size_t count) {
+    count = std::min(count, bank_pages * page_size);
+    for (size_t offset = 0; offset < count; offset += page_size) {
+        std::copy_n(data + offset, std::min(page_size, count - offset),
+                    writable_page(bank_page(bank) + offset / page_size));
+    }
+}
+
+void Bus::read_screen(uint8_t *out, size_t count) const {
+    for (size_t offset = 0; offset < count; offset += page_size) {
+        std::copy_n(pages[screen_page + offset / page_size]->data(), std::min(page_size, count - offset), out + offset);
+    }
+}
+
 void Bus::load_rom(std::string &rom_file) {
-    if (std::ifstream rom{rom_file, std::ios::binary | std::ios::ate}) {
-        auto rom_size = rom.tellg();
-        ram_start = rom_size;
-        rom.seekg(0);
-        rom.read(reinterpret_cast<char *>(&mem[0]), rom_size);
-        rom.close();
+    if (std::ifstream rom{rom_file, std::ios::binary}) {
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(rom)), std::istreambuf_iterator<char>());
+        load_rom(data.data(), data.size());
     } else {
         std::cerr << "No ROM file found called " << rom_file << std::endl;
         std::cerr << "ROM uninitialized" << std::endl;
-        ram_start = 0x4000;
+        set_ram_start(0x4000);
+    }
+}
+
+bool Bus::load_rom(const uint8_t *data, size_t size) {
+    if (machine_model == SpectrumModel::ZX128K) {
+        // The editor ROM goes in ROM 0 and the 48K BASIC ROM in ROM 1
+        if (size > rom_count * bank_pages * page_size) {
+            std::cerr << "ROM of " << size << " bytes does not fit in the two 128K ROMs" << std::endl;
+            return false;
+        }
+        for (size_t offset = 0; offset < size; offset += page_size) {
+            std::copy_n(data + offset, std::min(page_size, size - offset), writable_page(offset / page_size));
+        }
+        set_ram_start(static_cast<uint16_t>(std::min<size_t>(size, 0x4000)));
+        return true;
+    }
+
+    if (size > slot_page.size() * page_size) {
+        std::cerr << "ROM of " << size << " bytes does not fit in memory" << std::endl;
+        return false;
+    }
+
+    load_block(0, data, size);
+    set_ram_start(static_cast<uint16_t>(size));
+    return true;
+}
+
+void Bus::save_state(StateWriter &state) const {
+    for (const std::shared_ptr<Page> &page : pages) {
+        state.put_bytes(page->data(), page->size());
     }
+    state.put(ram_start);
+    state.put(port_254);
+    state.put(floating_counter);
+    state.put(static_cast<uint8_t>(machine_model));
+    state.put(port_7ffd);
+}
+
+bool Bus::load_state(StateReader &state) {
+    for (size_t page = 0; page < pages.size(); page++) {
+        state.get_bytes(writable_page(page), page_size);
+    }
+    uint8_t model = 0;
+    state.get(ram_start);
+    state.get(port_254);
+    state.get(floating_counter);
+    state.get(model);
+    state.get(port_7ffd);
+    machine_model =
+        (model == static_cast<uint8_t>(SpectrumModel::ZX128K)) ? SpectrumModel::ZX128K : SpectrumModel::ZX48K;
+    map_pages();
+
+    // Anything logged belongs to the frame being replaced
+    clear_screen_log();
+    mark_screen_dirty();
+    return state.ok() && model <= static_cast<uint8_t>(SpectrumModel::ZX128K);
 }
 
 uint8_t Bus::read_port(uint16_t addr) const {
@@ -28,23 +314,38 @@ uint8_t Bus::read_port(uint16_t addr) const {
 
     if (addr % 2 == 0) {
         uint8_t half_rows = (addr & 0xff00) >> 8;
-        return static_cast<uint8_t>(0xe0 | get_keyboard_state(half_rows));
+        uint8_t keys = (input != nullptr) ? input->read_keys(half_rows) : 0x1f;
+        return static_cast<uint8_t>(0xe0 | keys);
+    }
+    if (ay != nullptr && (addr & 0xc002) == 0xc000) {
+        return ay->read_data();
     }
 
     // Floating bus: return a byte from screen/attribute memory that changes over time.
-    uint16_t fb_addr = 0x4000 + (floating_counter++ & 0x3fff);
-    return mem[fb_addr];
+    return screen_byte(floating_counter++ & 0x3fff);
 }
 
 void Bus::write_port(uint16_t addr, uint8_t v) {
     if ((addr & 0xff) == 0xfe) {
         port_254 = v;
+        if (beeper != nullptr) {
+            beeper->write_port(frame_tstate, v);
+        }
+        screen_log_entries.push_back(ScreenWrite{frame_tstate, 0, v, true});
+    } else if (machine_model == SpectrumModel::ZX128K && (addr & 0x8002) == 0) {
+        // Port 0x7ffd is decoded from A15 and A1 being low
+        write_paging(v);
+    } else if (ay != nullptr && (addr & 0xc002) == 0xc000) {
+        // The sound chip decodes A15, A14 and A1: 0xfffd selects a register and 0xbffd writes it
+        ay->select(v);
+    } else if (ay != nullptr && (addr & 0xc002) == 0x8000) {
+        ay->write_data(v, frame_tstate);
     }
 }
 
 uint32_t Bus::read_opcode_from_mem(uint16_t addr, uint16_t *operand_offset) {
     uint16_t offset = 1;
-    uint32_t opcode = mem[addr];
+    uint32_t opcode = read_data(addr);
 
     // Handled extended instructions
     switch (opcode) {
@@ -52,7 +353,7 @@ uint32_t Bus::read_opcode_from_mem(uint16_t addr, uint16_t *operand_offset) {
         case 0xcb:
         case 0xdd:
         case 0xfd: {
-            opcode = (opcode << 8) | mem[addr + 1];
+            opcode = (opcode << 8) | read_data(static_cast<uint16_t>(addr + 1));
             offset++;
 
             // Handle IX and IY bit instructions, the opcode comes after
@@ -63,7 +364,7 @@ uint32_t Bus::read_opcode_from_mem(uint16_t addr, uint16_t *operand_offset) {
             switch (opcode) {
                 case 0xddcb:
                 case 0xfdcb:
-                    opcode = (opcode << 8) | mem[addr + 3];
+                    opcode = (opcode << 8) | read_data(static_cast<uint16_t>(addr + 3));
             }
         }
     }
@@ -4,16 +4,21 @@
 
 #pragma once
 
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <vector>
 
+#include "ay.hpp"
+#include "beeper.hpp"
 #include "common.hpp"
-#include "keyboard.hpp"
+#include "machine_io.hpp"
+#include "state.hpp"
 #include "storage_element.hpp"
 
 /**
@@ -21,34 +26,89 @@
  */
 class Z80;
 
+/**
+ * @brief Observer of writes to a range of memory, e.g. a watchpoint or dirty tracking.
+ */
+class MemoryWriteHook {
+public:
+    virtual ~MemoryWriteHook() {}
+    virtual void memory_written(uint16_t addr, uint8_t v) = 0;
+};
+
+/**
+ * @brief Machine being emulated.
+ */
+enum class SpectrumModel { ZX48K, ZX128K };
+
 /**
  * @brief Defines the memory/data bus of the device.
+ * Memory is held in 1K pages: two 16K ROMs followed by eight 16K RAM banks. The 64K address space is a table of
+ * 64 slots, each pointing at a page, so paging a bank in only rewrites slot pointers. The 48K machine is the 128K
+ * power-on layout (ROM 0, banks 5, 2 and 0) with paging disabled.
+ * Pages may be shared with forked buses. A shared page is copied the first time it is written, so a fork costs a
+ * handful of pointer copies however much memory there is.
+ * Each slot has a read and a write pointer. Plain RAM reads and writes through the same page, ROM writes go to a
+ * scratch page, and slots that are shared, hooked, hold the displayed screen or are partly ROM have no write pointer
+ * and take a slower path.
  */
 class Bus {
 public:
-    Bus(size_t size) : mem(size) {}
+    static constexpr size_t page_size = 1024;
+    static constexpr int page_shift = 10;
+    static constexpr size_t bank_pages = 0x4000 / page_size;
+
+    Bus(size_t size);
     virtual ~Bus() {}
 
+    /**
+     * @brief Share all of parent's memory copy-on-write and copy the rest of its state.
+     */
+    void fork_from(Bus &parent);
+
+    /**
+     * @brief Switch model, resetting the paging. Load the ROM after choosing the model.
+     */
+    void set_model(SpectrumModel model);
+    SpectrumModel model() const { return machine_model; }
+    uint8_t paging() const { return port_7ffd; }
+
     void load_rom(std::string &rom_file);
     void load_snapshot(std::string &sna_file, Z80 &state);
     void load_z80(std::string &z80_file, Z80 &state);
 
-    uint8_t &operator[](uint16_t addr) { return mem[addr]; }
+    // Loaders for images already in memory, these return false if the image could not be loaded
+    bool load_rom(const uint8_t *data, size_t size);
+    bool load_snapshot(std::istream &sna, Z80 &state);
+    bool load_z80(std::istream &z80, Z80 &state);
+
+    void save_state(StateWriter &state) const;
+    bool load_state(StateReader &state);
+
+    // Direct access for loaders and tests, bypasses ROM protection and screen tracking
+    uint8_t &operator[](uint16_t addr) { return writable_slot(addr)[addr & page_mask]; }
 
     uint8_t read_port(uint16_t addr) const;
     void write_port(uint16_t addr, uint8_t v);
 
-    uint8_t read_data(uint16_t addr) const { return mem[addr]; }
+    uint8_t read_data(uint16_t addr) const { return page_read[addr >> page_shift][addr & page_mask]; }
+    void read_block(uint16_t addr, uint8_t *out, size_t count) const;
 
     void write_data(uint16_t addr, uint8_t v) {
-        if (addr >= ram_start) {
-            mem[addr] = v;
+        uint8_t *page = page_write[addr >> page_shift];
+        if (page != nullptr) {
+            page[addr & page_mask] = v;
+        } else {
+            write_slow(addr, v);
         }
     }
 
+    // Write ignoring ROM protection and without logging, for loading images
+    void load_block(uint16_t addr, const uint8_t *data, size_t count);
+    void load_bank(uint8_t bank, const uint8_t *data, size_t count);
+
     uint16_t read_addr_from_mem(uint16_t addr) const {
-        uint16_t ret_addr = mem[addr];
-        ret_addr |= mem[addr + 1] << 8;
+        uint16_t ret_addr = read_data(addr);
+        ret_addr |= read_data(static_cast<uint16_t>(addr + 1)) << 8;
         return ret_addr;
     }
     void write_addr_to_mem(uint16_t addr, uint16_t addr_to_write) {
@@ -57,8 +117,36 @@ public:
     }
 
     StorageElement read_element_from_mem(uint16_t addr, size_t count) {
-        return StorageElement(&mem[addr], count, (addr < ram_start));
+        if (count == 2) {
+            return StorageElement(read_data(addr), read_data(static_cast<uint16_t>(addr + 1)));
+        }
+        return StorageElement(read_data(addr));
+    }
+
+    /**
+     * @brief Element referencing memory that an instruction may modify in place.
+     * Plain RAM is referenced directly. Anything else (ROM, screen, hooked or shared pages, or a word straddling two
+     * pages) is worked on in a buffer, which is written back through write_data() by flush_deferred() once the
+     * instruction has executed if it stored to the element, even when the value is unchanged.
+     */
+    StorageElement access_element(uint16_t addr, size_t count) {
+        size_t page = addr >> page_shift;
+        if (page_write[page] == page_read[page] && (count == 1 || (addr & page_mask) != page_mask)) {
+            return StorageElement(page_write[page] + (addr & page_mask), count);
+        }
+        return deferred_element(addr, count);
     }
+    void flush_deferred() {
+        if (deferred_count != 0) {
+            write_deferred();
+        }
+    }
+
+    /**
+     * @brief Call hook after each write to count bytes from start. Writes to a hooked page take the slow path.
+     */
+    void add_write_hook(uint16_t start, size_t count, MemoryWriteHook *hook);
+    void remove_write_hook(MemoryWriteHook *hook);
 
     uint32_t read_opcode_from_mem(uint16_t addr, uint16_t *operand_offset = nullptr);
 
@@ -66,11 +154,162 @@ public:
         // Not actively used at the moment but may be useful for debugging
     }
 
+    /**
+     * @brief Screen or border write stamped with the T-state within the frame at which it happened.
+     */
+    struct ScreenWrite {
+        uint32_t tstate;
+        uint16_t offset;  // Offset into display memory, unused for border writes
+        uint8_t value;
+        bool is_border;
+    };
+
+    /**
+     * @brief Marks the 8x8 character cell covering an offset into display memory as changed and logs the write.
+     */
+    void mark_dirty(uint16_t offset) {
+        if (offset < 0x1800) {
+            // Bitmap address bits are 010T TLLL RRRC CCCC (third, line, row, column)
+            dirty_rows[((offset >> 8) & 0x18) | ((offset >> 5) & 0x7)] |= 1u << (offset & 0x1f);
+        } else if (offset < 0x1b00) {
+            dirty_rows[(offset - 0x1800) >> 5] |= 1u << (offset & 0x1f);
+        } else {
+            return;
+        }
+
+        // Elements are written after they are created, so values are read back once a later instruction logs
+        if (resolved < screen_log_entries.size() && screen_log_entries.back().tstate != frame_tstate) {
+            resolve_screen_log();
+        }
+        screen_log_entries.push_back(ScreenWrite{frame_tstate, offset, 0, false});
+    }
+    void mark_screen_dirty() {
+        dirty_rows.fill(0xffffffff);
+        screen_reset = true;
+    }
+
+    // One bit per column for each of the 24 character rows, cleared by the renderer
+    std::array<uint32_t, 24> &screen_dirty_rows() { return dirty_rows; }
+
+    // Writes to the screen and border this frame in the order they happened
+    const std::vector<ScreenWrite> &screen_log() const { return screen_log_entries; }
+    void resolve_screen_log() {
+        for (size_t i = resolved; i < screen_log_entries.size(); i++) {
+            if (!screen_log_entries[i].is_border) {
+                screen_log_entries[i].value = screen_byte(screen_log_entries[i].offset);
+            }
+        }
+        resolved = screen_log_entries.size();
+    }
+    void clear_screen_log() {
+        screen_log_entries.clear();
+        resolved = 0;
+    }
+
+    // Display memory of the bank being shown, offset 0 is the first bitmap byte
+    uint8_t screen_byte(uint16_t offset) const {
+        return pages[screen_page + (offset >> page_shift)]->data()[offset & page_mask];
+    }
+    void read_screen(uint8_t *out, size_t count) const;
+
+    // Set when screen memory changed without being logged (e.g. a snapshot load), cleared by the renderer
+    bool take_screen_reset() {
+        bool reset = screen_reset;
+        screen_reset = false;
+        return reset;
+    }
+
+    // T-state within the current frame, kept up to date by the ULA
+    uint32_t frame_tstate = {0};
+
+    // Keyboard read through port 0xfe, no keys are pressed without one
+    InputSource *input = {nullptr};
+
+    // Sound chip on ports 0xfffd and 0xbffd, attached for the 128K only
+    AY *ay = {nullptr};
+    // Told of every write to port 0xfe
+    Beeper *beeper = {nullptr};
+
+    // Report progress of snapshot loads on stdout, errors are always reported on stderr
+    bool verbose = {true};
+
     // TODO - this needs to be dealt with better at some point
     uint8_t port_254 = {0};
     mutable uint16_t floating_counter = {0};
 
 private:
-    std::vector<uint8_t> mem;
+    using Page = std::array<uint8_t, page_size>;
+    static constexpr uint16_t page_mask = page_size - 1;
+    static constexpr size_t rom_count = 2;
+    static constexpr size_t bank_count = 8;
+    static constexpr size_t screen_pages = (0x1b00 + page_size - 1) / page_size;
+
+    static constexpr size_t rom_page(size_t rom) { return rom * bank_pages; }
+    static constexpr size_t bank_page(size_t bank) { return (rom_count + bank) * bank_pages; }
+
+    /**
+     * @brief Data of the page mapped at addr, copied first if it is shared with another bus.
+     */
+    uint8_t *writable_slot(uint16_t addr) { return writable_page(slot_page[addr >> page_shift]); }
+    uint8_t *writable_page(size_t page) {
+        if (!page_owned[page]) {
+            make_private(page);
+        }
+        return pages[page]->data();
+    }
+    void make_private(size_t page);
+
+    /**
+     * @brief Point the slot's write pointer at its page, the ROM sink, or nothing to force the slow path.
+     */
+    void update_slot(size_t slot);
+    void update_slots();
+    void set_ram_start(uint16_t addr);
+
+    /**
+     * @brief Map ROM and RAM into the slots from the model and the last value written to port 0x7ffd.
+     */
+    void map_pages();
+    void write_paging(uint8_t v);
+    void reset_paging(uint8_t v);
+
+    void write_slow(uint16_t addr, uint8_t v);
+    StorageElement deferred_element(uint16_t addr, size_t count);
+    void write_deferred();
+
+    std::vector<std::shared_ptr<Page>> pages;
+    std::vector<bool> page_owned;  // Known not to be shared with another bus
+
+    std::vector<uint16_t> slot_page;
+    std::vector<const uint8_t *> page_read;
+    std::vector<uint8_t *> page_write;
+    std::vector<bool> slot_hooked;
     uint16_t ram_start = {0x4000};
+    Page rom_sink = {};
+
+    SpectrumModel machine_model = {SpectrumModel::ZX48K};
+    uint8_t port_7ffd = {0};
+    size_t screen_page = {bank_page(5)};
+
+    struct WriteHook {
+        uint32_t start;
+        uint32_t end;
+        MemoryWriteHook *hook;
+    };
+    std::vector<WriteHook> write_hooks;
+
+    // Memory operands of the executing instruction that are not referenced directly
+    struct DeferredElement {
+        uint16_t addr;
+        size_t count;
+        uint8_t data[2];
+        bool written;
+    };
+    std::array<DeferredElement, 2> deferred = {};
+    size_t deferred_count = {0};
+
+    std::array<uint32_t, 24> dirty_rows = {};
+    std::vector<ScreenWrite> screen_log_entries;
+    size_t resolved = {0};
+    bool screen_reset = {false};
 };
@@ -0,0 +1,101 @@
+/**
+ * @brief Entry point of jrnz-client, a small tool for sending requests to jrnz-server.
+ */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static void print_help(const char *name) {
+    std::cout << "Run: " << name << " <socket> [request]\n";
+    std::cout << "Sends the request given on the command line, or each line read from stdin, and prints the replies.\n";
+    std::cout << "Round-trip times are reported on stderr. For example:\n";
+    std::cout << "\t" << name << " /tmp/jrnz.sock run file=game.z80 frames=100 keys=6:1 hold=5 ram=0x5c00:16\n";
+}
+
+static bool send_line(int fd, const std::string &line) {
+    for (size_t sent = 0; sent < line.size();) {
+        ssize_t written = send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+static bool read_line(int fd, std::string &pending, std::string &line) {
+    char buffer[4096];
+    size_t newline;
+    while ((newline = pending.find('\n')) == std::string::npos) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count <= 0) {
+            return false;
+        }
+        pending.append(buffer, static_cast<size_t>(count));
+    }
+    line = pending.substr(0, newline);
+    pending.erase(0, newline + 1);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || std::string(argv[1]) == "--help") {
+        print_help(argv[0]);
+        return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, argv[1], sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "Unable to connect to \'" << argv[1] << "\': " << std::strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string request;
+    for (int i = 2; i < argc; i++) {
+        if (i > 2) {
+            request += ' ';
+        }
+        request += argv[i];
+    }
+
+    std::string pending;
+    bool ok = true;
+    auto round_trip = [&](const std::string &line) {
+        auto start = std::chrono::steady_clock::now();
+        std::string reply;
+        if (!send_line(fd, line + "\n") || !read_line(fd, pending, reply)) {
+            std::cerr << "Connection closed by server\n";
+            ok = false;
+            return;
+        }
+        std::cout << reply << std::endl;
+        std::cerr << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                  << " ms\n";
+    };
+
+    if (!request.empty()) {
+        round_trip(request);
+    } else {
+        std::string line;
+        while (ok && std::getline(std::cin, line)) {
+            if (!line.empty()) {
+                round_trip(line);
+            }
+        }
+    }
+
+    close(fd);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
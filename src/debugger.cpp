@@ -91,6 +91,9 @@ bool Debugger::clock() {
                 case 'i':
                     _z80.int_nmi = true;
                     break;
+                case 'p':
+                    toggle_profiling();
+                    break;
                 case 'q':
                     running = false;
                     paused = false;
@@ -111,6 +114,7 @@ bool Debugger::clock() {
                         "\tu = continue to address on sp (tries to jump out of a "
                         "routine)\n"
                         "\ti = NMI\n"
+                        "\tp = pause/resume profiling\n"
                         "\tq = quit\n";
                     std::cout << help_text;
                     break;
@@ -217,3 +221,23 @@ void Debugger::dump_sp() {
     std::cout << dump_mem_at_addr(_z80.sp.get(), _z80.top_of_stack - _z80.sp.get()).str() << std::endl;
     std::cout << "==== TOP OF THE STACK ====" << std::endl;
 }
+
+void Debugger::toggle_profiling() {
+    if (_z80.opcode_profiler == nullptr && _z80.hotspot_profiler == nullptr && _z80.call_profiler == nullptr) {
+        std::cout << "Profiling not enabled (use --profile-opcodes, --profile-pc or --profile-calls)" << std::endl;
+        return;
+    }
+
+    if (_z80.opcode_profiler != nullptr) {
+        _z80.opcode_profiler->enabled = !_z80.opcode_profiler->enabled;
+        std::cout << "Opcode profiling " << (_z80.opcode_profiler->enabled ? "resumed" : "paused") << std::endl;
+    }
+    if (_z80.hotspot_profiler != nullptr) {
+        _z80.hotspot_profiler->enabled = !_z80.hotspot_profiler->enabled;
+        std::cout << "Hotspot profiling " << (_z80.hotspot_profiler->enabled ? "resumed" : "paused") << std::endl;
+    }
+    if (_z80.call_profiler != nullptr) {
+        _z80.call_profiler->enabled = !_z80.call_profiler->enabled;
+        std::cout << "Call profiling " << (_z80.call_profiler->enabled ? "resumed" : "paused") << std::endl;
+    }
+}
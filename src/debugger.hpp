@@ -31,6 +31,8 @@ public:
     void dump();
     void dump_sp();
 
+    void toggle_profiling();
+
 public:
     Z80 &_z80;
     Bus &_bus;
@@ -2,17 +2,21 @@
 . * Implement reading of Z80 file format.
  */
 
+#include <algorithm>
+#include <vector>
+
+#include "ay.hpp"
 #include "bus.hpp"
 #include "z80.hpp"
 
 // TODO move this to a utility area
-static uint8_t get_next_byte(std::ifstream &stream) {
+static uint8_t get_next_byte(std::istream &stream) {
     char ch;
     stream.get(ch);
     return static_cast<uint8_t>(ch);
 }
 
-static uint16_t get_next_ushort(std::ifstream &stream) {
+static uint16_t get_next_ushort(std::istream &stream) {
     uint16_t val;
     val = get_next_byte(stream) & 0xff;
     val |= (get_next_byte(stream) << 8) & 0xff00;
@@ -20,15 +24,23 @@ static uint16_t get_next_ushort(std::ifstream &stream) {
 }
 
 /**
- * @brief Read a data block from a Z80 file into memory.
+ * @brief Read a data block from a Z80 file, decompressing it into out. Bytes beyond out_size are dropped.
+ * Returns the number of bytes stored.
  */
-static void read_data_block(uint32_t version, std::vector<uint8_t> &mem, std::ifstream &stream, bool compressed,
-                            uint16_t addr_start, uint16_t size) {
-    uint16_t mem_pos = addr_start;
+static size_t read_data_block(uint32_t version, uint8_t *out, size_t out_size, std::istream &stream, bool compressed,
+                            uint16_t size, bool verbose) {
+    size_t out_pos = 0;
+    auto put = [&](uint8_t v) {
+        if (out_pos < out_size) {
+            out[out_pos] = v;
+        }
+        out_pos++;
+    };
 
     if (!compressed) {
         // If block of data is uncompressed then just write the remaining file to memory
-        stream.read(reinterpret_cast<char *>(&mem[mem_pos]), size);
+        stream.read(reinterpret_cast<char *>(out), std::min<size_t>(size, out_size));
+        return static_cast<size_t>(stream.gcount());
     } else {
         // while (stream.peek() != EOF || size--) {
         uint32_t pos = 0;
@@ -49,7 +61,7 @@ static void read_data_block(uint32_t version, std::vector<uint8_t> &mem, std::if
                 uint8_t compressed_byte = get_next_byte(stream);
                 assert(count > 0);
                 while (count--) {
-                    mem[mem_pos++] = compressed_byte;
+                    put(compressed_byte);
                 }
                 pos += 3;
             } else if (version == 1 && this_byte == 0x00 && stream.peek() == 0xED) {
@@ -59,28 +71,32 @@ static void read_data_block(uint32_t version, std::vector<uint8_t> &mem, std::if
                 uint8_t byte_4 = get_next_byte(stream);
                 if (byte_3 == 0xED && byte_4 == 0x00) {
                     // Block end reached
-                    std::cout << "Z80 Block end found at: " << static_cast<uint16_t>(mem_pos - 1) << std::endl;
+                    if (verbose) {
+                        std::cout << "Z80 Block end found at: " << static_cast<uint16_t>(0x4000 + out_pos - 1)
+                                  << std::endl;
+                    }
                     break;
                 } else {
                     // Not the end of memory, so write first byte out and put back
                     // the remaining 3 bytes
-                    mem[mem_pos++] = this_byte;
+                    put(this_byte);
                     stream.putback(byte_4);
                     stream.putback(byte_3);
                     stream.putback(byte_2);
                 }
             } else {
                 // Normal byte - write it to memory
-                mem[mem_pos++] = this_byte;
+                put(this_byte);
             }
         }
     }
+    return std::min(out_pos, out_size);
 }
 
 /**
  * @brief Read the first header.
  */
-void read_header_1(std::ifstream &stream, Z80 &state, Bus &bus, uint32_t &version, bool &compression_on) {
+void read_header_1(std::istream &stream, Z80 &state, Bus &bus, uint32_t &version, bool &compression_on) {
     // 0x00 - AF
     state.af.lo(get_next_byte(stream));
     state.af.hi(get_next_byte(stream));
@@ -198,7 +214,7 @@ void read_header_1(std::ifstream &stream, Z80 &state, Bus &bus, uint32_t &versio
 /**
  * @brief Read the first header.
  */
-void read_header_2(std::ifstream &stream, Z80 &state, uint32_t &version) {
+bool read_header_2(std::istream &stream, Z80 &state, Bus &bus, uint32_t &version, bool &is_128k, uint8_t &paging) {
     // 0x30 - Length of header 2
     uint16_t length = get_next_ushort(stream);
 
@@ -208,25 +224,30 @@ void read_header_2(std::ifstream &stream, Z80 &state, uint32_t &version) {
         version = 3;
     } else {
         std::cerr << "Error: unknown version of Z80 file (length " << length << ")\n";
-        exit(-1);
+        return false;
     }
 
     // 0x32 - PC
     state.pc.lo(get_next_byte(stream));
     state.pc.hi(get_next_byte(stream));
 
-    // 0x34 - Hardware mode
+    // 0x34 - Hardware mode, the 128K modes moved up one in version 3 when 48k + M.G.T. was added
     uint8_t hardware_mode = get_next_byte(stream);
-    if (hardware_mode != 0) {
-        std::cerr << "Error: Only 48k hardware mode is currently supported with Z80 files (mode " << std::hex
+    if (hardware_mode == 0) {
+        is_128k = false;
+    } else if ((version == 2 && (hardware_mode == 3 || hardware_mode == 4)) ||
+               (version == 3 &&
+                (hardware_mode == 4 || hardware_mode == 5 || hardware_mode == 6 || hardware_mode == 12))) {
+        // Interface 1 and M.G.T. variants of the 128k and the +2 run as a plain 128k
+        is_128k = true;
+    } else {
+        std::cerr << "Error: Only 48k and 128k hardware modes are supported with Z80 files (mode " << std::hex
                   << static_cast<int>(hardware_mode) << std::dec << ")\n";
-        exit(-1);
+        return false;
     }
 
-    // 0x35 - OUT state
-    // Ignore this as we only support 48k for now
-    uint8_t out_state = get_next_byte(stream);
-    UNUSED(out_state);
+    // 0x35 - OUT state, the last byte written to port 0x7ffd in 128k mode
+    paging = get_next_byte(stream);
 
     // 0x36 - interface 1 ROM paged
     // Ignore this as we neither support interface 1 nor Timex
@@ -238,19 +259,22 @@ void read_header_2(std::ifstream &stream, Z80 &state, uint32_t &version) {
     uint8_t emulation_bits = get_next_byte(stream);
     UNUSED(emulation_bits);
 
-    // 0x38 - last OUT to soundchip
-    // Ignore this as we do not support 128k Spectrums
+    // 0x38 - last OUT to port 0xfffd, the selected sound chip register
     uint8_t last_out = get_next_byte(stream);
-    UNUSED(last_out);
 
-    // 0x39 - contents of the sound chip
-    // Our emulator ignores this for now
-    char sound_chip_contents[16];
-    stream.read(sound_chip_contents, 16);
-    UNUSED(sound_chip_contents);
+    // 0x39 - contents of the sound chip registers, only meaningful in 128k mode
+    uint8_t sound_chip_contents[16];
+    stream.read(reinterpret_cast<char *>(sound_chip_contents), sizeof(sound_chip_contents));
+    if (is_128k && bus.ay != nullptr) {
+        for (uint8_t reg = 0; reg < 16; reg++) {
+            bus.ay->select(reg);
+            bus.ay->write_data(sound_chip_contents[reg], bus.frame_tstate);
+        }
+        bus.ay->select(last_out & 0x0f);
+    }
 
     if (version == 2) {
-        return;
+        return true;
     }
 
     // 0x55 - low T state counter
@@ -324,12 +348,13 @@ void read_header_2(std::ifstream &stream, Z80 &state, uint32_t &version) {
         uint8_t last_out = get_next_byte(stream);
         UNUSED(last_out);
     }
+    return true;
 }
 
 /**
  * @brief Read the first header.
  */
-void read_block_header(std::ifstream &stream, uint16_t &length, bool &is_compressed, uint8_t &page) {
+void read_block_header(std::istream &stream, uint16_t &length, bool &is_compressed, uint8_t &page) {
     length = get_next_ushort(stream);
     if (length == 0xffff) {
         length = 16384;
@@ -341,85 +366,134 @@ void read_block_header(std::ifstream &stream, uint16_t &length, bool &is_compres
 }
 
 /**
- * @brief Get start address from page number.
+ * @brief Get the 48k start address of a page, returns false for pages that cannot be loaded.
  */
-uint16_t get_addr_start_from_page(uint8_t page) {
+static bool get_addr_start_from_page(uint8_t page, uint16_t &addr_start) {
     switch (page) {
         case 0:
-            return 0x0000;
+            addr_start = 0x0000;
+            return true;
         case 1:
             std::cerr << "Error: interface 1 ROM is not supported\n";
-            exit(-1);
-        case 2:
-            std::cerr << "Error: ROM is 128k mode is not supported\n";
-            exit(-1);
-        case 3:
-            std::cerr << "Error: page 0 in 128k mode is not supported\n";
-            exit(-1);
+            return false;
         case 4:
-            return 0x8000;
+            addr_start = 0x8000;
+            return true;
         case 5:
-            return 0xc000;
-        case 6:
-            std::cerr << "Error: page 3 in 128k mode is not supported\n";
-            exit(-1);
-        case 7:
-            std::cerr << "Error: page 4 in 128k mode is not supported\n";
-            exit(-1);
+            addr_start = 0xc000;
+            return true;
         case 8:
-            return 0x4000;
-        case 9:
-            std::cerr << "Error: page 6 in 128k mode is not supported\n";
-            exit(-1);
-        case 10:
-            std::cerr << "Error: page 7 in 128k mode is not supported\n";
-            exit(-1);
+            addr_start = 0x4000;
+            return true;
         case 11:
             std::cerr << "Error: Multiface ROM is not supported\n";
-            exit(-1);
+            return false;
         default:
-            std::cerr << "Error: unknown page: " << page << std::endl;
-            exit(-1);
+            std::cerr << "Error: page " << static_cast<int>(page) << " is not used in 48k mode\n";
+            return false;
+    }
+}
+
+/**
+ * @brief Load a 128k page: 0 is the 48k BASIC ROM, 2 the editor ROM and 3-10 the RAM banks 0-7.
+ */
+static bool load_128k_page(Bus &bus, uint8_t page, const std::vector<uint8_t> &block) {
+    if (page >= 3 && page <= 10) {
+        bus.load_bank(page - 3, block.data(), block.size());
+        return true;
+    }
+    switch (page) {
+        case 1:
+            std::cerr << "Error: interface 1 ROM is not supported\n";
+            return false;
+        case 11:
+            std::cerr << "Error: Multiface ROM is not supported\n";
+            return false;
+        case 0:
+        case 2:
+            // ROMs are only saved by some emulators, the machine keeps the ROMs it was given
+            return true;
+        default:
+            std::cerr << "Error: unknown page: " << static_cast<int>(page) << std::endl;
+            return false;
     }
 }
 
 void Bus::load_z80(std::string &z80_file, Z80 &state) {
-    if (std::ifstream z80{z80_file, std::ios::binary | std::ios::ate}) {
-        uint32_t version = 0;
-        auto file_size = z80.tellg();
-        UNUSED(file_size);
+    if (std::ifstream z80{z80_file, std::ios::binary}) {
+        if (!load_z80(z80, state)) {
+            // Unsupported images used to stop the emulator, keep doing so for files named on the command line
+            exit(-1);
+        }
+    } else {
+        std::cerr << "No Z80 file found called \'" << z80_file << "\'" << std::endl;
+        std::cerr << "Z80 file failed to load" << std::endl;
+    }
+}
 
-        z80.seekg(0);
+bool Bus::load_z80(std::istream &z80, Z80 &state) {
+    uint32_t version = 0;
+    z80.seekg(0);
 
-        bool compression_on = false;
-        read_header_1(z80, state, *this, version, compression_on);
+    bool compression_on = false;
+    read_header_1(z80, state, *this, version, compression_on);
 
-        if (version != 1) {
-            read_header_2(z80, state, version);
-            std::cout << "Z80 version " << version << " format detected\n";
+    bool is_128k = false;
+    uint8_t paging = 0;
+    if (version != 1) {
+        if (!read_header_2(z80, state, *this, version, is_128k, paging)) {
+            return false;
+        }
+        if (verbose) {
+            std::cout << "Z80 version " << version << " format detected" << (is_128k ? " (128k)" : "") << "\n";
+        }
+        if (is_128k && machine_model != SpectrumModel::ZX128K) {
+            std::cerr << "Error: 128k snapshots need the 128k model\n";
+            return false;
+        }
 
-            // Read blocks of data into memory
-            while (z80.peek() != EOF) {
-                uint16_t size = 0;
-                bool is_compressed = false;
-                uint8_t page = 0;
+        // Read blocks of data into memory
+        std::vector<uint8_t> block(0x4000);
+        while (z80.peek() != EOF) {
+            uint16_t size = 0;
+            bool is_compressed = false;
+            uint8_t page = 0;
 
-                read_block_header(z80, size, is_compressed, page);
+            read_block_header(z80, size, is_compressed, page);
+            block.resize(0x4000);
+            block.resize(read_data_block(version, block.data(), block.size(), z80, is_compressed, size, verbose));
 
-                uint16_t addr_start = get_addr_start_from_page(page);
-                read_data_block(version, mem, z80, is_compressed, addr_start, size);
+            if (is_128k) {
+                if (!load_128k_page(*this, page, block)) {
+                    return false;
+                }
+            } else {
+                uint16_t addr_start = 0;
+                if (!get_addr_start_from_page(page, addr_start)) {
+                    return false;
+                }
+                load_block(addr_start, block.data(), block.size());
             }
-        } else {
+        }
+    } else {
+        if (verbose) {
             std::cout << "Z80 version 1 format detected\n";
-            // For version one the rest of the block is data
-            read_data_block(version, mem, z80, compression_on, 16384, 49152);
         }
+        // For version one the rest of the block is data
+        std::vector<uint8_t> ram(0xc000);
+        size_t count = read_data_block(version, ram.data(), ram.size(), z80, compression_on, 49152, verbose);
+        load_block(0x4000, ram.data(), count);
+    }
+
+    // A 48k snapshot on a 128k runs with the 48k BASIC ROM and paging locked
+    if (machine_model == SpectrumModel::ZX128K) {
+        reset_paging(is_128k ? paging : 0x30);
+    }
 
-        z80.close();
+    mark_screen_dirty();
 
+    if (verbose) {
         std::cout << "Setting PC to: " << state.pc << "\n";
-    } else {
-        std::cerr << "No Z80 file found called \'" << z80_file << "\'" << std::endl;
-        std::cerr << "Z80 file failed to load" << std::endl;
     }
+    return true;
 }
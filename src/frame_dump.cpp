@@ -0,0 +1,69 @@
+/**
+ * @brief Implementation of the frame dumper.
+ */
+
+#include "frame_dump.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "common.hpp"
+
+bool FrameDumper::open_hashes(const std::string &filename) {
+    hashes.open(filename);
+    if (!hashes) {
+        std::cerr << "Unable to write frame hashes to \'" << filename << "\'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FrameDumper::frame(const uint32_t *pixels, bool changed) {
+    // Every frame is written so the output lines up with frame numbers
+    UNUSED(changed);
+
+    if (hashes.is_open()) {
+        hashes << frame_number << " " << std::hex << std::setw(16) << std::setfill('0')
+               << hash(pixels, static_cast<size_t>(width) * height) << std::dec << std::setfill(' ') << "\n";
+    }
+
+    if (!image_prefix.empty()) {
+        std::stringstream filename;
+        filename << image_prefix << std::setw(6) << std::setfill('0') << frame_number << ".ppm";
+        write_ppm(filename.str(), pixels, width, height);
+    }
+
+    frame_number++;
+}
+
+uint64_t FrameDumper::hash(const uint32_t *pixels, size_t count) {
+    uint64_t h = 0xcbf29ce484222325;
+    for (size_t i = 0; i < count; i++) {
+        for (int shift = 16; shift >= 0; shift -= 8) {
+            h ^= (pixels[i] >> shift) & 0xff;
+            h *= 0x100000001b3;
+        }
+    }
+    return h;
+}
+
+bool FrameDumper::write_ppm(const std::string &filename, const uint32_t *pixels, int width, int height) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        std::cerr << "Unable to write frame to \'" << filename << "\'" << std::endl;
+        return false;
+    }
+
+    out << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<char> rgb(static_cast<size_t>(width) * height * 3);
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+        rgb[i * 3] = static_cast<char>((pixels[i] >> 16) & 0xff);
+        rgb[i * 3 + 1] = static_cast<char>((pixels[i] >> 8) & 0xff);
+        rgb[i * 3 + 2] = static_cast<char>(pixels[i] & 0xff);
+    }
+    out.write(rgb.data(), static_cast<std::streamsize>(rgb.size()));
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,37 @@
+/**
+ * @brief Header defining the frame dumper used for headless runs.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "machine_io.hpp"
+
+/**
+ * @brief Writes every completed frame as a PPM image and/or a line of its hash.
+ * Hashes are 64-bit FNV-1a over the RGB bytes so runs can be compared frame by frame without keeping images.
+ */
+class FrameDumper : public VideoSink {
+public:
+    FrameDumper(int _width, int _height) : width(_width), height(_height) {}
+    virtual ~FrameDumper() {}
+
+    bool open_hashes(const std::string &filename);
+    void set_image_prefix(const std::string &prefix) { image_prefix = prefix; }
+
+    void frame(const uint32_t *pixels, bool changed) override;
+
+    static uint64_t hash(const uint32_t *pixels, size_t count);
+    static bool write_ppm(const std::string &filename, const uint32_t *pixels, int width, int height);
+
+private:
+    int width;
+    int height;
+    uint64_t frame_number = {0};
+
+    std::string image_prefix = {""};
+    std::ofstream hashes;
+};
@@ -0,0 +1,84 @@
+/**
+ * @brief Implementation of the SDL audio output.
+ */
+
+#include "sdl_audio.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <cstring>
+#include <iostream>
+
+SDLAudio::~SDLAudio() {
+    if (device != 0) {
+        SDL_CloseAudioDevice(device);
+    }
+    if (initialised) {
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+}
+
+bool SDLAudio::open() {
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+        std::cerr << "Unable to initialize SDL audio: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    initialised = true;
+
+    SDL_zero(audiospec);
+    audiospec.freq = static_cast<int>(Beeper::default_sample_rate);
+    audiospec.format = AUDIO_S16SYS;
+    audiospec.channels = 1;
+    audiospec.samples = samples;
+    audiospec.callback = SDLAudio::audio_callback;
+    audiospec.userdata = reinterpret_cast<void *>(this);
+
+    // Any rate the device prefers will do, the beeper synthesises at whatever rate it is given
+    SDL_AudioSpec obtained;
+    device = SDL_OpenAudioDevice(nullptr, 0, &audiospec, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (device == 0) {
+        std::cerr << "Failed to initialize the audio device\n";
+        return false;
+    }
+    rate = static_cast<uint32_t>(obtained.freq);
+
+    SDL_PauseAudioDevice(device, 0);
+    std::cout << "Audio initialized at " << rate << " Hz\n";
+    return true;
+}
+
+void SDLAudio::set_tracer(Tracer *_tracer) {
+    if (device == 0) {
+        tracer = _tracer;
+        return;
+    }
+
+    // The audio callback runs on its own thread so swap the pointer while it is locked out
+    SDL_LockAudioDevice(device);
+    tracer = _tracer;
+    SDL_UnlockAudioDevice(device);
+}
+
+void SDLAudio::write(const int16_t *block, size_t count) {
+    if (device == 0) {
+        return;
+    }
+
+    // When the ring is full the newest samples are dropped and counted by the ring
+    ring.write(block, count);
+}
+
+void SDLAudio::audio_callback(void *userdata, Uint8 *stream, int len) {
+    SDLAudio *audio = reinterpret_cast<SDLAudio *>(userdata);
+    Tracer::Span trace_fill(audio->tracer, "audio fill", "audio");
+
+    int16_t *out = reinterpret_cast<int16_t *>(stream);
+    size_t wanted = static_cast<size_t>(len) / sizeof(int16_t);
+    size_t count = audio->ring.read(out, wanted);
+    if (count < wanted) {
+        if (audio->tracer != nullptr) {
+            audio->tracer->instant("audio underrun", "audio");
+        }
+        std::memset(reinterpret_cast<void *>(out + count), 0x0, (wanted - count) * sizeof(int16_t));
+    }
+}
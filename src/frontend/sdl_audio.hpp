@@ -0,0 +1,55 @@
+/**
+ * @brief Header defining the SDL audio output.
+ */
+
+#pragma once
+
+#include <SDL2/SDL_audio.h>
+
+#include <cstdint>
+
+#include "beeper.hpp"
+#include "machine_io.hpp"
+#include "sample_ring.hpp"
+#include "tracer.hpp"
+
+// Varying the number of buffers is a balance between improving the quality of the output but increasing the delay in
+// output
+constexpr uint32_t num_buffers = 4;
+constexpr uint16_t samples = 1024;
+
+/**
+ * @brief Plays beeper samples through an SDL audio device.
+ * Opening the output initializes the SDL audio subsystem, which is released again on destruction. Samples reach the
+ * audio callback through a lock-free ring, so the emulation thread never waits for the audio thread.
+ */
+class SDLAudio : public AudioSink {
+public:
+    SDLAudio() {}
+    virtual ~SDLAudio();
+
+    bool open();
+    void write(const int16_t *samples, size_t count) override;
+    float fill() const override { return static_cast<float>(ring.available()) / ring.capacity(); }
+    void set_tracer(Tracer *_tracer);
+
+    // The rate the device was opened at, the beeper should produce samples at this rate
+    uint32_t sample_rate() const { return rate; }
+
+    // Callbacks that found too few samples, and writes that found the ring full
+    uint64_t underruns() const { return ring.underruns(); }
+    uint64_t overruns() const { return ring.overruns(); }
+
+private:
+    static void audio_callback(void *userdata, Uint8 *stream, int len);
+
+    SampleRing ring{num_buffers * samples};
+
+    Tracer *tracer = {nullptr};
+
+    uint32_t rate = {Beeper::default_sample_rate};
+
+    SDL_AudioSpec audiospec;
+    SDL_AudioDeviceID device = {0};
+    bool initialised = {false};
+};
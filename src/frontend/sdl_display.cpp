@@ -0,0 +1,130 @@
+/**
+ * @brief Implementation of the SDL window that shows the emulated display.
+ */
+
+#include "sdl_display.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "common.hpp"
+#include "sdl_keyboard.hpp"
+
+SDLDisplay::~SDLDisplay() {
+    if (texture != nullptr) {
+        SDL_DestroyTexture(texture);
+    }
+    if (renderer != nullptr) {
+        SDL_DestroyRenderer(renderer);
+    }
+    if (window != nullptr) {
+        SDL_DestroyWindow(window);
+    }
+    if (subsystem != 0) {
+        SDL_QuitSubSystem(subsystem);
+    }
+}
+
+bool SDLDisplay::open(const char *title, int scale) {
+#ifdef HAVE_DISPLAY
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
+        std::cerr << "Unable to initialize SDL: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    subsystem = SDL_INIT_VIDEO;
+
+    window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, ULA::frame_width * scale,
+                              ULA::frame_height * scale, 0);
+    if (!window) {
+        std::cerr << "Could not create window: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    renderer = SDL_CreateRenderer(window, -1, 0);
+    // The ULA renders into a host framebuffer which is uploaded once a frame and scaled to the window
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, ULA::frame_width,
+                                ULA::frame_height);
+    if (!texture) {
+        std::cerr << "Could not create texture: " << SDL_GetError() << std::endl;
+        return false;
+    }
+#else
+    UNUSED(title);
+    UNUSED(scale);
+    if (SDL_InitSubSystem(SDL_INIT_EVENTS) != 0) {
+        std::cerr << "Unable to initialize SDL: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    subsystem = SDL_INIT_EVENTS;
+#endif
+
+    return true;
+}
+
+void SDLDisplay::frame(const uint32_t *pixels, bool changed) {
+    // Only changed frames are handed over, the display thread may still be busy with an older one
+    if (!changed) {
+        return;
+    }
+
+    std::copy(pixels, pixels + ULA::frame_width * ULA::frame_height, frames.back());
+    if (frames.publish() && tracer != nullptr) {
+        tracer->instant("frame dropped", "video");
+    }
+}
+
+void SDLDisplay::run(ULA &ula, KeyMatrix &keys, const std::atomic<bool> &running) {
+    bool redraw = false;
+
+    while (running) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                ula.exit_requested = true;
+            } else if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+                if (event.key.keysym.scancode == SDL_SCANCODE_TAB) {
+                    ula.break_requested = true;
+                } else if (event.key.keysym.scancode == SDL_SCANCODE_ESCAPE) {
+                    ula.exit_requested = true;
+                } else if (event.key.keysym.scancode == SDL_SCANCODE_F5) {
+                    // Cycle through 1x, 2x, 4x and as fast as possible
+                    uint32_t speed = ula.speed;
+                    ula.speed = (speed == 0) ? 1 : ((speed >= 4) ? 0 : speed * 2);
+                    if (ula.speed == 0) {
+                        std::cout << "Speed: unlimited\n";
+                    } else {
+                        std::cout << "Speed: " << ula.speed << "x\n";
+                    }
+                }
+            } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                redraw = true;
+            }
+        }
+        update_key_matrix(keys, SDL_GetKeyboardState(NULL));
+
+        if (texture != nullptr && frames.acquire()) {
+            Tracer::Span trace_upload(tracer, "upload", "video");
+            SDL_UpdateTexture(texture, nullptr, frames.front(), ULA::frame_width * sizeof(uint32_t));
+            redraw = true;
+        }
+
+        if (texture != nullptr && redraw) {
+            Tracer::Span trace_present(tracer, "present", "video");
+            SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+            SDL_RenderPresent(renderer);
+            redraw = false;
+        } else {
+            SDL_Delay(1);
+        }
+    }
+}
+
+void SDLDisplay::wait_close() {
+    SDL_Event event;
+
+    while (1) {
+        SDL_PollEvent(&event);
+        if (event.type == SDL_QUIT) {
+            return;
+        }
+    }
+}
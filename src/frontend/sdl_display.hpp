@@ -0,0 +1,51 @@
+/**
+ * @brief Header defining the SDL window that shows the emulated display.
+ */
+
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "keyboard.hpp"
+#include "machine_io.hpp"
+#include "tracer.hpp"
+#include "triple_buffer.hpp"
+#include "ula.hpp"
+
+/**
+ * @brief Window presenting frames from the ULA and feeding host keyboard events back to it.
+ * Frames arrive on the emulation thread and are handed over through a triple buffer; everything else, including
+ * event handling, happens on the main thread as SDL expects.
+ */
+class SDLDisplay : public VideoSink {
+public:
+    SDLDisplay() : frames(ULA::frame_width * ULA::frame_height) {}
+    virtual ~SDLDisplay();
+
+    bool open(const char *title, int scale);
+
+    void frame(const uint32_t *pixels, bool changed) override;
+
+    /**
+     * @brief Handles host events and presents published frames until running is cleared.
+     */
+    void run(ULA &ula, KeyMatrix &keys, const std::atomic<bool> &running);
+
+    /**
+     * @brief Waits for the window to be closed.
+     */
+    void wait_close();
+
+    Tracer *tracer = {nullptr};
+
+private:
+    SDL_Window *window = {nullptr};
+    SDL_Renderer *renderer = {nullptr};
+    SDL_Texture *texture = {nullptr};
+    Uint32 subsystem = {0};
+
+    TripleBuffer frames;
+};
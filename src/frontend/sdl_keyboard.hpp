@@ -0,0 +1,14 @@
+/**
+ * @brief Defines the mapping from the host keyboard to the Spectrum key matrix.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "keyboard.hpp"
+
+/**
+ * @brief Latch the host keyboard (an SDL_GetKeyboardState array) into the Spectrum key matrix.
+ */
+void update_key_matrix(KeyMatrix &matrix, const uint8_t *key_state);
@@ -0,0 +1,103 @@
+/**
+ * @brief Implementation of the host-side subsystem time profiler.
+ */
+
+#include "host_profiler.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+size_t HostProfiler::Histogram::bucket_of(uint64_t ns) {
+    if (ns < 16) {
+        return static_cast<size_t>(ns);
+    }
+
+    size_t exponent = 63 - static_cast<size_t>(__builtin_clzll(ns));
+    size_t sub = static_cast<size_t>(ns >> (exponent - 3)) & 0x7;
+    size_t bucket = 16 + (exponent - 4) * 8 + sub;
+    return bucket < num_buckets ? bucket : num_buckets - 1;
+}
+
+uint64_t HostProfiler::Histogram::bucket_value(size_t bucket) {
+    if (bucket < 16) {
+        return bucket;
+    }
+
+    size_t exponent = (bucket - 16) / 8 + 4;
+    uint64_t sub = (bucket - 16) % 8;
+    // Report the middle of the bucket
+    uint64_t low = (8 + sub) << (exponent - 3);
+    return low + (uint64_t{1} << (exponent - 4));
+}
+
+void HostProfiler::Histogram::add(uint64_t ns) {
+    buckets[bucket_of(ns)]++;
+    count++;
+    total_ns += ns;
+    if (ns < min_ns) {
+        min_ns = ns;
+    }
+    if (ns > max_ns) {
+        max_ns = ns;
+    }
+}
+
+uint64_t HostProfiler::Histogram::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(p * static_cast<double>(count - 1));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < num_buckets; i++) {
+        seen += buckets[i];
+        if (seen > target) {
+            uint64_t value = bucket_value(i);
+            return value < min_ns ? min_ns : (value > max_ns ? max_ns : value);
+        }
+    }
+
+    return max_ns;
+}
+
+const char *HostProfiler::section_name(size_t section) {
+    static const char *names[num_sections + 2] = {"z80", "debugger", "render", "present", "pacing",
+                                                  "beeper", "other", "frame"};
+    return names[section];
+}
+
+void HostProfiler::end_frame() {
+    clock::time_point now = clock::now();
+    uint64_t frame_total = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_frame).count();
+    last_frame = now;
+
+    uint64_t accounted = 0;
+    for (size_t i = 0; i < num_sections; i++) {
+        histograms[i].add(frame_ns[i]);
+        accounted += frame_ns[i];
+        frame_ns[i] = 0;
+    }
+
+    // Whatever is not covered by a scope is the per T-state loop itself
+    histograms[num_sections].add(frame_total > accounted ? frame_total - accounted : 0);
+    histograms[num_sections + 1].add(frame_total);
+
+    frame_count++;
+    if (report_interval != 0 && (frame_count % report_interval) == 0) {
+        report(std::cout);
+    }
+}
+
+void HostProfiler::report(std::ostream &out) const {
+    out << "Host time per emulated frame over " << frame_count << " frames (microseconds)\n";
+    out << std::left << std::setw(10) << "section" << std::right << std::setw(10) << "min" << std::setw(10)
+        << "median" << std::setw(10) << "mean" << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    for (size_t i = 0; i < histograms.size(); i++) {
+        const Histogram &h = histograms[i];
+        out << std::left << std::setw(10) << section_name(i) << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << us(h.min()) << std::setw(10) << us(h.percentile(0.5)) << std::setw(10)
+            << us(h.mean()) << std::setw(10) << us(h.percentile(0.99)) << std::setw(10) << us(h.max()) << "\n";
+    }
+}
@@ -0,0 +1,111 @@
+/**
+ * @brief Header defining the host-side subsystem time profiler.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Measures the host time spent in each emulator subsystem and aggregates it per emulated frame.
+ * The instrumentation scopes are only compiled in when JRNZ_HOST_PROFILE is defined (see ENABLE_HOST_PROFILE in
+ * CMakeLists.txt) so a normal build pays nothing for them.
+ */
+class HostProfiler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum class Section { Z80, Debugger, Render, Present, Pacing, Beeper, Count };
+    static constexpr size_t num_sections = static_cast<size_t>(Section::Count);
+
+    /**
+     * @brief Adds the time between construction and destruction to a section.
+     */
+    class Scope {
+    public:
+        Scope(HostProfiler *_profiler, Section _section) : profiler(_profiler), section(_section) {
+            if (profiler != nullptr) {
+                start = clock::now();
+            }
+        }
+        ~Scope() {
+            if (profiler != nullptr) {
+                profiler->add(section, clock::now() - start);
+            }
+        }
+
+    private:
+        HostProfiler *profiler;
+        Section section;
+        clock::time_point start;
+    };
+
+    HostProfiler() : last_frame(clock::now()) {}
+    virtual ~HostProfiler() {}
+
+    void add(Section section, clock::duration time) {
+        frame_ns[static_cast<size_t>(section)] += std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+    }
+
+    void end_frame();
+    void report(std::ostream &out) const;
+
+    uint64_t frames() const { return frame_count; }
+
+    // Print a report every report_interval frames (0 reports on exit only)
+    uint64_t report_interval = {0};
+
+private:
+    /**
+     * @brief Log-linear histogram of nanosecond samples (8 sub-buckets per power of two).
+     */
+    class Histogram {
+    public:
+        void add(uint64_t ns);
+        uint64_t percentile(double p) const;
+        uint64_t min() const { return count ? min_ns : 0; }
+        uint64_t max() const { return max_ns; }
+        uint64_t mean() const { return count ? total_ns / count : 0; }
+
+    private:
+        static constexpr size_t num_buckets = 16 + 48 * 8;
+
+        static size_t bucket_of(uint64_t ns);
+        static uint64_t bucket_value(size_t bucket);
+
+        std::array<uint64_t, num_buckets> buckets = {};
+        uint64_t count = {0};
+        uint64_t total_ns = {0};
+        uint64_t min_ns = {UINT64_MAX};
+        uint64_t max_ns = {0};
+    };
+
+    static const char *section_name(size_t section);
+
+    std::array<uint64_t, num_sections> frame_ns = {};
+    std::array<Histogram, num_sections + 2> histograms;  // Sections followed by "other" and the whole frame
+    clock::time_point last_frame;
+    uint64_t frame_count = {0};
+};
+
+#ifdef JRNZ_HOST_PROFILE
+#define HOST_PROFILE_SCOPE(profiler, section) \
+    HostProfiler::Scope host_profile_scope_##section((profiler), HostProfiler::Section::section)
+#define HOST_PROFILE_SCOPE_IF(profiler, section, cond) \
+    HostProfiler::Scope host_profile_scope_##section(((cond) ? (profiler) : nullptr), HostProfiler::Section::section)
+#define HOST_PROFILE_END_FRAME(profiler) \
+    do {                                 \
+        if ((profiler) != nullptr) {     \
+            (profiler)->end_frame();     \
+        }                                \
+    } while (0)
+#else
+#define HOST_PROFILE_SCOPE(profiler, section)
+#define HOST_PROFILE_SCOPE_IF(profiler, section, cond)
+#define HOST_PROFILE_END_FRAME(profiler) \
+    do {                                 \
+    } while (0)
+#endif
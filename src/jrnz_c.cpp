@@ -0,0 +1,77 @@
+/**
+ * @brief Implementation of the C interface on top of Machine.
+ */
+
+#include "jrnz.h"
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "machine.hpp"
+
+struct jrnz_machine {
+    Machine machine;
+};
+
+jrnz_machine *jrnz_create(void) { return new (std::nothrow) jrnz_machine; }
+
+void jrnz_destroy(jrnz_machine *machine) { delete machine; }
+
+int jrnz_set_model(jrnz_machine *machine, int model) {
+    if (model != 48 && model != 128) {
+        return -1;
+    }
+    machine->machine.set_model((model == 128) ? SpectrumModel::ZX128K : SpectrumModel::ZX48K);
+    return 0;
+}
+
+int jrnz_load_rom(jrnz_machine *machine, const uint8_t *data, size_t size) {
+    return machine->machine.load_rom(data, size) ? 0 : -1;
+}
+
+int jrnz_load_sna(jrnz_machine *machine, const uint8_t *data, size_t size) {
+    return machine->machine.load_sna(data, size) ? 0 : -1;
+}
+
+int jrnz_load_z80(jrnz_machine *machine, const uint8_t *data, size_t size) {
+    return machine->machine.load_z80(data, size) ? 0 : -1;
+}
+
+uint32_t jrnz_run_frames(jrnz_machine *machine, uint32_t count) { return machine->machine.run_frames(count); }
+
+uint64_t jrnz_frames_completed(const jrnz_machine *machine) { return machine->machine.frames_completed(); }
+
+void jrnz_set_key_row(jrnz_machine *machine, uint8_t row, uint8_t keys) { machine->machine.set_key_row(row, keys); }
+
+const uint32_t *jrnz_framebuffer(const jrnz_machine *machine, int *width, int *height) {
+    if (width != nullptr) {
+        *width = ULA::frame_width;
+    }
+    if (height != nullptr) {
+        *height = ULA::frame_height;
+    }
+    return machine->machine.framebuffer();
+}
+
+size_t jrnz_read_audio(jrnz_machine *machine, int16_t *out, size_t max) {
+    return machine->machine.read_audio(out, max);
+}
+
+uint32_t jrnz_audio_frequency(void) { return Beeper::default_sample_rate; }
+
+void jrnz_read_memory(const jrnz_machine *machine, uint16_t addr, uint8_t *out, size_t count) {
+    machine->machine.read_memory(addr, out, count);
+}
+
+size_t jrnz_save_state(const jrnz_machine *machine, uint8_t *out, size_t max) {
+    std::vector<uint8_t> state = machine->machine.save_state();
+    if (out != nullptr && max >= state.size()) {
+        std::copy(state.begin(), state.end(), out);
+    }
+    return state.size();
+}
+
+int jrnz_restore_state(jrnz_machine *machine, const uint8_t *data, size_t size) {
+    return machine->machine.restore_state(data, size) ? 0 : -1;
+}
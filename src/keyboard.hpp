@@ -4,6 +4,30 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 
-uint8_t get_keyboard_state(uint8_t halfrows);
+#include "machine_io.hpp"
+
+/**
+ * @brief Spectrum keyboard matrix of eight half-rows of five keys.
+ * Rows may be set from any thread (e.g. one handling host events) while the emulation reads them.
+ */
+class KeyMatrix : public InputSource {
+public:
+    KeyMatrix() {}
+    virtual ~KeyMatrix() {}
+
+    uint8_t read_keys(uint8_t halfrows) override;
+
+    /**
+     * @brief Set the pressed keys (active high, bits 0-4) of a half-row, numbered as port 0xfe address bits 8-15.
+     */
+    void set_row(uint8_t row, uint8_t keys) { rows[row & 0x7].store(keys & 0x1f, std::memory_order_relaxed); }
+    uint8_t row(uint8_t row) const { return rows[row & 0x7].load(std::memory_order_relaxed); }
+    void clear();
+
+private:
+    std::array<std::atomic<uint8_t>, 8> rows = {};
+};
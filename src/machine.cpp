@@ -0,0 +1,185 @@
+/**
+ * @brief Implementation of the embeddable machine.
+ */
+
+#include "machine.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include "state.hpp"
+
+Machine::Machine()
+    : mem(65536), z80(mem), ula(z80, mem, true), debugger(z80, mem), sys(z80, ula, mem, debugger, beeper) {
+    mem.input = &key_matrix;
+    mem.verbose = false;
+    ula.add_video_sink(this);
+    beeper.audio = this;
+}
+
+void Machine::set_model(SpectrumModel model) {
+    mem.set_model(model);
+    ay.reset();
+    apply_model();
+}
+
+void Machine::apply_model() {
+    ula.set_model(mem.model());
+    beeper.set_cpu_clock(ula.clock_hz());
+    AY *chip = (mem.model() == SpectrumModel::ZX128K) ? &ay : nullptr;
+    mem.ay = chip;
+    beeper.attach_sound_chip(chip);
+}
+
+bool Machine::load_rom(const uint8_t *data, size_t size) { return mem.load_rom(data, size); }
+
+bool Machine::load_sna(const uint8_t *data, size_t size) {
+    std::istringstream sna(std::string(reinterpret_cast<const char *>(data), size));
+    return mem.load_snapshot(sna, z80);
+}
+
+bool Machine::load_z80(const uint8_t *data, size_t size) {
+    std::istringstream image(std::string(reinterpret_cast<const char *>(data), size));
+    return mem.load_z80(image, z80);
+}
+
+uint32_t Machine::run_frames(uint32_t count) {
+    uint64_t target = ula.frames_completed() + count;
+
+    while (ula.frames_completed() < target) {
+        if (!sys.clock()) {
+            break;
+        }
+    }
+
+    return static_cast<uint32_t>(ula.frames_completed() - (target - count));
+}
+
+size_t Machine::read_audio(int16_t *out, size_t max) {
+    size_t count = std::min(max, audio_samples.size());
+    std::copy(audio_samples.begin(), audio_samples.begin() + count, out);
+    audio_samples.erase(audio_samples.begin(), audio_samples.begin() + count);
+    return count;
+}
+
+void Machine::read_memory(uint16_t addr, uint8_t *out, size_t count) const {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = mem.read_data(static_cast<uint16_t>(addr + i));
+    }
+}
+
+uint64_t Machine::memory_hash(uint16_t addr, size_t count) const {
+    uint64_t h = 0xcbf29ce484222325;
+    for (size_t i = 0; i < count; i++) {
+        h ^= mem.read_data(static_cast<uint16_t>(addr + i));
+        h *= 0x100000001b3;
+    }
+    return h;
+}
+
+std::vector<uint8_t> Machine::save_state() const {
+    StateWriter state;
+    state.put(state_magic);
+    state.put(state_version);
+
+    z80.save_state(state);
+    mem.save_state(state);
+    ula.save_state(state);
+    beeper.save_state(state);
+    ay.save_state(state);
+
+    return state.data;
+}
+
+bool Machine::restore_state(const uint8_t *data, size_t size) {
+    // Loaded into a scratch machine first, so a state rejected part way through leaves this one untouched. Once it
+    // has loaded there it cannot fail here.
+    Machine scratch;
+    if (!scratch.load_state(data, size)) {
+        return false;
+    }
+
+    load_state(data, size);
+    audio_samples.clear();
+    return true;
+}
+
+bool Machine::restore_trusted_state(const uint8_t *data, size_t size) {
+    if (!load_state(data, size)) {
+        return false;
+    }
+    audio_samples.clear();
+    return true;
+}
+
+size_t Machine::state_size() const {
+    // Every field has a fixed size, the same for both models
+    static const size_t size = save_state().size();
+    return size;
+}
+
+bool Machine::load_state(const uint8_t *data, size_t size) {
+    StateReader state(data, size);
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!state.get(magic) || !state.get(version) || magic != state_magic || version != state_version) {
+        std::cerr << "Not a machine state saved by this version" << std::endl;
+        return false;
+    }
+
+    if (size != state_size()) {
+        std::cerr << "Machine state is " << size << " bytes, expected " << state_size() << std::endl;
+        return false;
+    }
+
+    bool ok = z80.load_state(state);
+    ok = mem.load_state(state) && ok;
+    apply_model();
+    ok = ula.load_state(state) && ok;
+    ok = beeper.load_state(state) && ok;
+    ok = ay.load_state(state) && ok;
+    if (!ok || !state.at_end()) {
+        std::cerr << "Machine state is damaged" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<Machine> Machine::fork() {
+    std::unique_ptr<Machine> child = std::make_unique<Machine>();
+
+    // Memory is shared, the model is set up before the sound state that depends on its clock is loaded
+    child->mem.fork_from(mem);
+    child->apply_model();
+
+    // The CPU and sound are small enough to go through their state
+    StateWriter state;
+    z80.save_state(state);
+    beeper.save_state(state);
+    ay.save_state(state);
+    StateReader reader(state.data.data(), state.data.size());
+    child->z80.load_state(reader);
+    child->beeper.load_state(reader);
+    child->ay.load_state(reader);
+
+    child->ula.fork_from(ula);
+    for (uint8_t row = 0; row < 8; row++) {
+        child->key_matrix.set_row(row, key_matrix.row(row));
+    }
+    child->last_frame_changed = last_frame_changed;
+    return child;
+}
+
+void Machine::frame(const uint32_t *pixels, bool changed) {
+    UNUSED(pixels);
+    last_frame_changed = changed;
+}
+
+void Machine::write(const int16_t *samples, size_t count) {
+    audio_samples.insert(audio_samples.end(), samples, samples + count);
+    if (audio_samples.size() > max_audio_samples) {
+        audio_samples.erase(audio_samples.begin(), audio_samples.end() - max_audio_samples);
+    }
+}
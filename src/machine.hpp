@@ -0,0 +1,118 @@
+/**
+ * @brief Header defining a complete emulated machine for embedding in other programs.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "ay.hpp"
+#include "beeper.hpp"
+#include "bus.hpp"
+#include "debugger.hpp"
+#include "keyboard.hpp"
+#include "machine_io.hpp"
+#include "system.hpp"
+#include "ula.hpp"
+#include "z80.hpp"
+
+/**
+ * @brief A 48K or 128K machine that runs as fast as it is driven, with no window, audio device or pacing.
+ * Machines share no state, so any number may be created and each may be run on its own thread. A single machine
+ * must only be used from one thread at a time.
+ */
+class Machine : public VideoSink, public AudioSink {
+public:
+    // Beeper samples kept for read_audio(), the oldest are dropped beyond this
+    static constexpr size_t max_audio_samples = Beeper::default_sample_rate;
+
+    Machine();
+    virtual ~Machine() {}
+
+    Machine(const Machine &) = delete;
+    Machine &operator=(const Machine &) = delete;
+
+    // 48K unless changed, choose the model before loading the ROM (32K, editor then BASIC, for the 128K)
+    void set_model(SpectrumModel model);
+    SpectrumModel model() const { return mem.model(); }
+
+    // Images are copied in, the buffers only need to live for the duration of the call
+    bool load_rom(const uint8_t *data, size_t size);
+    bool load_sna(const uint8_t *data, size_t size);
+    bool load_z80(const uint8_t *data, size_t size);
+
+    /**
+     * @brief Run until count more frames complete. Returns the number that did, fewer if the machine stopped.
+     */
+    uint32_t run_frames(uint32_t count);
+    uint64_t frames_completed() const { return ula.frames_completed(); }
+
+    // Half-rows are numbered as port 0xfe address bits 8-15, keys are active high in bits 0-4
+    void set_key_row(uint8_t row, uint8_t keys) { key_matrix.set_row(row, keys); }
+    KeyMatrix &keys() { return key_matrix; }
+
+    // ARGB8888, ULA::frame_width by ULA::frame_height, as of the last completed frame
+    const uint32_t *framebuffer() const { return ula.frame(); }
+    bool frame_changed() const { return last_frame_changed; }
+
+    /**
+     * @brief Move up to max buffered samples (signed 16-bit mono at Beeper::default_sample_rate) into out.
+     */
+    size_t read_audio(int16_t *out, size_t max);
+    size_t audio_available() const { return audio_samples.size(); }
+
+    uint8_t read_memory(uint16_t addr) const { return mem.read_data(addr); }
+    void read_memory(uint16_t addr, uint8_t *out, size_t count) const;
+
+    // FNV-1a hash of count bytes of memory, by default all of RAM
+    uint64_t memory_hash(uint16_t addr = 0x4000, size_t count = 0xc000) const;
+
+    std::vector<uint8_t> save_state() const;
+    // Returns false and leaves the machine as it was if the state is from another version or damaged
+    bool restore_state(const uint8_t *data, size_t size);
+    /**
+     * @brief Restore a state this program saved itself and has kept unchanged, without first trying it on a scratch
+     * machine. Still checked as it loads, but the machine is left part way through restoring if it fails.
+     */
+    bool restore_trusted_state(const uint8_t *data, size_t size);
+    // Bytes in every saved state
+    size_t state_size() const;
+
+    /**
+     * @brief Create a machine that carries on from this one's current state. Memory is shared copy-on-write a page
+     * at a time, so a fork is cheap and only costs memory for the pages either machine goes on to write. The fork
+     * may be run on another thread, but the parent must not be running while fork() is called.
+     */
+    std::unique_ptr<Machine> fork();
+
+    Z80 &cpu() { return z80; }
+    Bus &bus() { return mem; }
+
+    void frame(const uint32_t *pixels, bool changed) override;
+    void write(const int16_t *samples, size_t count) override;
+
+private:
+    // Set the ULA timing and sound chip to match the model of the bus
+    void apply_model();
+    // Load a state without first checking it can be, the machine is left part way on failure
+    bool load_state(const uint8_t *data, size_t size);
+
+    static constexpr uint32_t state_magic = 0x5a4e524a;  // "JRNZ"
+    static constexpr uint32_t state_version = 4;
+
+    Bus mem;
+    Z80 z80;
+    ULA ula;
+    Debugger debugger;
+    Beeper beeper;
+    AY ay;
+    KeyMatrix key_matrix;
+    System sys;
+
+    bool last_frame_changed = {false};
+    std::deque<int16_t> audio_samples;
+};
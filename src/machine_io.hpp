@@ -0,0 +1,57 @@
+/**
+ * @brief Header defining the interfaces between the emulated machine and the host.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Receives every frame completed by the ULA.
+ * Pixels are ARGB8888, ULA::frame_width by ULA::frame_height including the border. changed is false when the frame
+ * is identical to the previous one. Called on the emulation thread.
+ */
+class VideoSink {
+public:
+    virtual ~VideoSink() {}
+    virtual void frame(const uint32_t *pixels, bool changed) = 0;
+};
+
+/**
+ * @brief Receives blocks of signed 16-bit mono samples from the beeper, with the 128K sound chip mixed in.
+ * Called on the emulation thread.
+ */
+class AudioSink {
+public:
+    virtual ~AudioSink() {}
+    virtual void write(const int16_t *samples, size_t count) = 0;
+
+    /**
+     * @brief Called instead of write() for samples that are not to be heard, while running faster than real time.
+     * Sinks that record keep them so the recording stays in step with the emulated time, the rest drop them.
+     */
+    virtual void write_muted(const int16_t *samples, size_t count) {
+        (void)samples;
+        (void)count;
+    }
+
+    /**
+     * @brief How full the sink's queue is, from 0 to 1. The beeper nudges its rate to keep this near a half, so sinks
+     * without a queue report exactly that.
+     */
+    virtual float fill() const { return 0.5f; }
+};
+
+/**
+ * @brief Provides the state of the keyboard when the emulated machine reads port 0xfe.
+ */
+class InputSource {
+public:
+    virtual ~InputSource() {}
+
+    /**
+     * @brief Keys pressed in the half-rows whose address bit is low, active low in bits 0-4 as the ULA returns them.
+     */
+    virtual uint8_t read_keys(uint8_t halfrows) = 0;
+};
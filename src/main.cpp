@@ -1,27 +1,43 @@
-#include <SDL2/SDL.h>
-
+#include <atomic>
+#include <csignal>
 #include <cstdlib>
 #include <iostream>
+#include <thread>
 
+#include "audio_capture.hpp"
+#include "ay.hpp"
 #include "beeper.hpp"
 #include "bus.hpp"
 #include "debugger.hpp"
+#include "frame_dump.hpp"
+#include "keyboard.hpp"
 #include "options.hpp"
+#include "sdl_audio.hpp"
+#include "sdl_display.hpp"
+#include "symbols.hpp"
 #include "system.hpp"
+#include "tracer.hpp"
 #include "ula.hpp"
+#include "video_capture.hpp"
 #include "z80.hpp"
 
-SDL_Window *window = nullptr;
-SDL_Renderer *renderer = nullptr;
+// Set by the signal handler and serviced from the emulation loop
+static std::atomic<int> profile_signal = {0};
 
-void wait_keypress() {
-    SDL_Event event;
+static void handle_profile_signal(int sig) { profile_signal = sig; }
 
-    while (1) {
-        SDL_PollEvent(&event);
-        if (event.type == SDL_QUIT) {
-            return;
-        }
+static void dump_profiles(const Options &options, const OpcodeProfiler &opcode_profiler,
+                          const HotspotProfiler &hotspot_profiler, const CallProfiler &call_profiler,
+                          const SymbolTable &symbols) {
+    if (options.profile_opcodes_on) {
+        opcode_profiler.dump(options.profile_opcodes_file);
+    }
+    if (options.profile_pc_on) {
+        hotspot_profiler.dump(options.profile_pc_file, symbols);
+    }
+    if (options.profile_calls_on) {
+        call_profiler.dump(options.profile_calls_file, symbols);
+        call_profiler.report(std::cout, symbols);
     }
 }
 
@@ -31,43 +47,91 @@ void wait_keypress() {
 int main(int argc, char **argv) {
     std::cout << "Running jrnz..." << std::endl;
 
-#ifdef HAVE_DISPLAY
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) {
-        std::cerr << "Unable to initialize SDL: " << SDL_GetError() << std::endl;
-        return EXIT_FAILURE;
-    }
+    Options options(argc, argv);
 
-    window = SDL_CreateWindow("JRNZ", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 960, 768, 0);
-    if (!window) {
-        std::cerr << "Could not create window: " << SDL_GetError() << std::endl;
-        return EXIT_FAILURE;
+    // Declared before the audio output so the audio thread never outlives it
+    Tracer tracer;
+    if (options.trace_on && tracer.open(options.trace_file)) {
+        tracer.set_thread_name("display");
     }
-    renderer = SDL_CreateRenderer(window, -1, 0);
-    SDL_RenderSetScale(renderer, 3.0f, 3.0f);
-#else
-    if (SDL_Init(SDL_INIT_EVENTS) != 0) {
-        std::cerr << "Unable to initialize SDL: " << SDL_GetError() << std::endl;
-        return EXIT_FAILURE;
+    Tracer *trace = tracer.is_open() ? &tracer : nullptr;
+
+    // Headless runs never touch SDL so they work without a display or audio device
+    SDLDisplay display;
+    SDLAudio audio;
+    if (!options.headless) {
+        if (!display.open("JRNZ", 3)) {
+            return EXIT_FAILURE;
+        }
+        audio.open();
+        display.tracer = trace;
+        audio.set_tracer(trace);
     }
-#endif
-
-    Options options(argc, argv);
 
     Bus mem(65536);
     Z80 state(mem, options.fast_mode);
-    ULA ula(state, mem, options.fast_mode);
+    // Headless runs use emulated time only so the ULA never paces them against the host clock
+    ULA ula(state, mem, options.fast_mode || options.headless);
     Debugger debug(state, mem);
-    Beeper beeper = {};
+    Beeper beeper;
+    AY ay;
+    KeyMatrix keys;
 
     System sys(state, ula, mem, debug, beeper);
+    mem.input = &keys;
+    ula.tracer = trace;
+    ula.speed = options.speed;
+    ula.auto_warp = options.auto_warp;
+    if (!options.headless) {
+        ula.add_video_sink(&display);
+        beeper.audio = &audio;
+        beeper.set_sample_rate(audio.sample_rate());
+    }
+
+    AudioCapture audio_capture;
+    if (options.audio_file_on) {
+        if (!audio_capture.open(options.audio_file, beeper.sample_rate())) {
+            return EXIT_FAILURE;
+        }
+        audio_capture.forward = beeper.audio;
+        beeper.audio = &audio_capture;
+    }
+
+    FrameDumper frame_dumper(ULA::frame_width, ULA::frame_height);
+    if (options.dump_frames_on) {
+        frame_dumper.set_image_prefix(options.dump_frames_prefix);
+    }
+    if (options.frame_hashes_on && !frame_dumper.open_hashes(options.frame_hashes_file)) {
+        return EXIT_FAILURE;
+    }
+    if (options.dump_frames_on || options.frame_hashes_on) {
+        ula.add_recording_sink(&frame_dumper);
+    }
+
+    VideoCapture video_capture(ULA::frame_width, ULA::frame_height);
+    if (options.video_file_on) {
+        if (!video_capture.open(options.video_file, options.video_skip)) {
+            return EXIT_FAILURE;
+        }
+        ula.add_recording_sink(&video_capture);
+    }
 
     // Use options to set up system
+    if (options.model_128k) {
+        mem.set_model(SpectrumModel::ZX128K);
+        ula.set_model(SpectrumModel::ZX128K);
+        beeper.set_cpu_clock(ula.clock_hz());
+        mem.ay = &ay;
+        beeper.attach_sound_chip(&ay);
+    }
     if (options.rom_on) {
         mem.load_rom(options.rom_file);
     }
     if (options.sna_on) {
+        Tracer::Span trace_load(trace, "load snapshot", "io");
         mem.load_snapshot(options.sna_file, state);
     } else if (options.z80_on) {
+        Tracer::Span trace_load(trace, "load snapshot", "io");
         mem.load_z80(options.z80_file, state);
     }
 
@@ -76,23 +140,103 @@ int main(int argc, char **argv) {
         debug.set_break(true, options.break_addr);
     }
 
-    bool running = true;
+    OpcodeProfiler opcode_profiler;
+    HotspotProfiler hotspot_profiler;
+    CallProfiler call_profiler;
+    SymbolTable symbols;
+    if (options.symbols_on) {
+        symbols.load(options.symbols_file);
+    }
+    if (options.profile_opcodes_on) {
+        state.opcode_profiler = &opcode_profiler;
+    }
+    if (options.profile_pc_on) {
+        state.hotspot_profiler = &hotspot_profiler;
+    }
+    if (options.profile_calls_on) {
+        state.call_profiler = &call_profiler;
+    }
+    if (options.profile_opcodes_on || options.profile_pc_on || options.profile_calls_on) {
+        std::signal(SIGUSR1, handle_profile_signal);
+        std::signal(SIGUSR2, handle_profile_signal);
+    }
 
-    do {
-        running = sys.clock();
-    } while (running);
+#ifdef JRNZ_HOST_PROFILE
+    HostProfiler host_profiler;
+    host_profiler.report_interval = options.host_profile_interval;
+    sys.host_profiler = &host_profiler;
+    ula.host_profiler = &host_profiler;
+    beeper.host_profiler = &host_profiler;
+#else
+    if (options.host_profile_interval != 0) {
+        std::cerr << "Host profiling is not available in this build (configure with -DENABLE_HOST_PROFILE=ON)\n";
+    }
+#endif
 
-    std::cout << "Closing jrnz.\n";
+    std::atomic<bool> running = {true};
+    auto emulate = [&]() {
+        if (trace != nullptr) {
+            trace->set_thread_name("emulation");
+        }
 
-    if (options.pause_on_quit) {
-        std::cout << "Emulation stopped. Close window to exit.\n";
-        wait_keypress();
+        bool alive = true;
+        do {
+            alive = sys.clock();
+
+            if (options.max_frames != 0 && ula.frames_completed() >= options.max_frames) {
+                alive = false;
+            }
+
+            if (profile_signal != 0) {
+                if (profile_signal == SIGUSR1) {
+                    dump_profiles(options, opcode_profiler, hotspot_profiler, call_profiler, symbols);
+                } else {
+                    opcode_profiler.enabled = !opcode_profiler.enabled;
+                    hotspot_profiler.enabled = !hotspot_profiler.enabled;
+                    call_profiler.enabled = !call_profiler.enabled;
+                }
+                profile_signal = 0;
+            }
+        } while (alive);
+
+        running = false;
+    };
+
+    if (options.headless) {
+        emulate();
+    } else {
+        // Emulate on a separate thread so a slow display drops frames rather than slowing the emulation
+        std::thread emulation(emulate);
+        display.run(ula, keys, running);
+        emulation.join();
     }
 
-#ifdef HAVE_DISPLAY
-    SDL_DestroyWindow(window);
+    std::cout << "Closing jrnz.\n";
+    if (options.audio_file_on) {
+        audio_capture.close();
+        std::cout << "Wrote " << audio_capture.samples_written() << " audio samples to " << options.audio_file << "\n";
+    }
+    if (options.video_file_on) {
+        video_capture.close();
+        std::cout << "Wrote " << video_capture.frames_written() << " frames to " << options.video_file << " ("
+                  << video_capture.frames_dropped() << " repeated while the writer caught up)\n";
+    }
+    if (!options.headless) {
+        std::cout << "Audio underruns: " << audio.underruns() << ", overruns: " << audio.overruns() << std::endl;
+    }
+
+    dump_profiles(options, opcode_profiler, hotspot_profiler, call_profiler, symbols);
+#ifdef JRNZ_HOST_PROFILE
+    host_profiler.report(std::cout);
 #endif
-    SDL_Quit();
+
+    audio.set_tracer(nullptr);
+    tracer.close();
+
+    if (options.pause_on_quit && !options.headless) {
+        std::cout << "Emulation stopped. Close window to exit.\n";
+        display.wait_close();
+    }
 
     return EXIT_SUCCESS;
 }
@@ -6,6 +6,8 @@
 
 #include <getopt.h>
 
+#include <cctype>
+#include <cerrno>
 #include <iostream>
 
 void Options::print_help() {
@@ -22,6 +24,32 @@ void Options::print_help() {
                  "runs as fast as possible)\n";
     std::cout << "\t--pause           - Pause window before closing application "
                  "(useful for debugging)\n";
+    std::cout << "\t--model <48|128> - Machine to emulate (default 48), the 128 needs its 32K ROM\n";
+    std::cout << "\t--speed <n|max> - Run at <n> times real time (default 1) rendering every <n>th frame, or as fast "
+                 "as possible; sound is muted above 1x. F5 cycles 1x, 2x, 4x and max while running. --dump-frames, "
+                 "--frame-hashes, --audio-out and --video-out still record every frame\n";
+    std::cout << "\t--auto-warp - Run as fast as possible while the ROM tape loader (LD-BYTES) is running\n";
+    std::cout << "\t--headless - Run without a window, audio or keyboard and as fast as possible\n";
+    std::cout << "\t--frames <n> - Stop after <n> frames\n";
+    std::cout << "\t--dump-frames <prefix> - Write each frame to <prefix>NNNNNN.ppm\n";
+    std::cout << "\t--frame-hashes <filename> - Write a hash of each frame to <filename>, one line per frame\n";
+    std::cout << "\t--audio-out <filename> - Write the sound to <filename>, a WAV file if it ends in .wav and raw "
+                 "signed 16-bit mono samples otherwise (a named pipe works), with or without --headless\n";
+    std::cout << "\t--video-out <filename> - Write the frames to <filename> as an uncompressed y4m stream, for "
+                 "example a named pipe read by ffmpeg\n";
+    std::cout << "\t--video-skip <n> - Capture one frame in every <n>, for long --fast or --headless runs\n";
+    std::cout << "\t--profile-opcodes <filename> - Count executions and T-states per opcode and write "
+                 "them to a CSV (or .json) file on exit or on SIGUSR1 (SIGUSR2 pauses/resumes)\n";
+    std::cout << "\t--profile-pc <filename> - Count executions and T-states per address and write a report "
+                 "of the hottest routines on exit or on SIGUSR1 (SIGUSR2 pauses/resumes)\n";
+    std::cout << "\t--profile-calls <filename> - Track the emulated call stack and write T-states per call path "
+                 "as folded stacks (for flamegraph.pl or speedscope) on exit or on SIGUSR1\n";
+    std::cout << "\t--host-profile <frames> - Report host time per subsystem every <frames> frames as well as on "
+                 "exit (needs a build with ENABLE_HOST_PROFILE)\n";
+    std::cout << "\t--trace <filename> - Write a Chrome trace-event timeline of frames, rendering, pacing and "
+                 "audio (open in Perfetto or chrome://tracing)\n";
+    std::cout << "\t--symbols <filename> - Load user symbols (\"<addr> <name>\" per line) to name routines in "
+                 "profiles\n";
     exit(EXIT_SUCCESS);
 }
 
@@ -29,7 +57,16 @@ void Options::process() {
     static struct option long_options[] = {
         {"help", no_argument, 0, 'h'},      {"debug", no_argument, 0, 'd'},     {"fast", no_argument, 0, 'f'},
         {"pause", no_argument, 0, 'p'},     {"rom", required_argument, 0, 'r'}, {"break", required_argument, 0, 'b'},
-        {"sna", required_argument, 0, 's'}, {"z80", required_argument, 0, 'z'}, {0, 0, 0, 0}};
+        {"sna", required_argument, 0, 's'}, {"z80", required_argument, 0, 'z'},
+        {"profile-opcodes", required_argument, 0, 'o'}, {"profile-pc", required_argument, 0, 'c'},
+        {"profile-calls", required_argument, 0, 'g'}, {"host-profile", required_argument, 0, 't'},
+        {"trace", required_argument, 0, 'e'},        {"symbols", required_argument, 0, 'y'},
+        {"headless", no_argument, 0, 'H'},           {"frames", required_argument, 0, 'n'},
+        {"dump-frames", required_argument, 0, 'D'},  {"frame-hashes", required_argument, 0, 'x'},
+        {"model", required_argument, 0, 'm'},        {"audio-out", required_argument, 0, 'a'},
+        {"video-out", required_argument, 0, 'v'},    {"video-skip", required_argument, 0, 'k'},
+        {"speed", required_argument, 0, 'S'},        {"auto-warp", no_argument, 0, 'W'},
+        {0, 0, 0, 0}};
 
     int c;
 
@@ -81,6 +118,117 @@ void Options::process() {
                 break;
             }
 
+            case 'o': {
+                profile_opcodes_file = optarg;
+                profile_opcodes_on = true;
+                break;
+            }
+
+            case 'c': {
+                profile_pc_file = optarg;
+                profile_pc_on = true;
+                break;
+            }
+
+            case 'g': {
+                profile_calls_file = optarg;
+                profile_calls_on = true;
+                break;
+            }
+
+            case 't': {
+                host_profile_interval = strtoull(optarg, NULL, 0);
+                break;
+            }
+
+            case 'e': {
+                trace_file = optarg;
+                trace_on = true;
+                break;
+            }
+
+            case 'm': {
+                if (std::string(optarg) != "48" && std::string(optarg) != "128") {
+                    std::cerr << "Model should be 48 or 128\n";
+                    exit(EXIT_FAILURE);
+                }
+                model_128k = (std::string(optarg) == "128");
+                break;
+            }
+
+            case 'S': {
+                unsigned long val = (std::string(optarg) == "max") ? 0 : strtoul(optarg, NULL, 0);
+                if (std::string(optarg) != "max" && (val < 1 || val > 16)) {
+                    std::cerr << "Speed should be between 1 and 16, or max\n";
+                    exit(EXIT_FAILURE);
+                }
+                speed = static_cast<uint32_t>(val);
+                break;
+            }
+
+            case 'W': {
+                auto_warp = true;
+                break;
+            }
+
+            case 'H': {
+                headless = true;
+                break;
+            }
+
+            case 'n': {
+                // A mistyped count must not turn into 0, which would run a headless machine forever
+                char *end = nullptr;
+                errno = 0;
+                max_frames = strtoull(optarg, &end, 0);
+                if (!std::isdigit(static_cast<unsigned char>(optarg[0])) || *end != '\0' || errno != 0 ||
+                    max_frames == 0) {
+                    std::cerr << "Frames should be a count of at least 1\n";
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+
+            case 'D': {
+                dump_frames_prefix = optarg;
+                dump_frames_on = true;
+                break;
+            }
+
+            case 'x': {
+                frame_hashes_file = optarg;
+                frame_hashes_on = true;
+                break;
+            }
+
+            case 'a': {
+                audio_file = optarg;
+                audio_file_on = true;
+                break;
+            }
+
+            case 'v': {
+                video_file = optarg;
+                video_file_on = true;
+                break;
+            }
+
+            case 'k': {
+                unsigned long val = strtoul(optarg, NULL, 0);
+                if (val < 1 || val > 50) {
+                    std::cerr << "Video skip should be between 1 and 50\n";
+                    exit(EXIT_FAILURE);
+                }
+                video_skip = static_cast<uint32_t>(val);
+                break;
+            }
+
+            case 'y': {
+                symbols_file = optarg;
+                symbols_on = true;
+                break;
+            }
+
             case 'b': {
                 unsigned long int val = strtoul(optarg, NULL, 0);
                 if (val > UINT16_MAX) {
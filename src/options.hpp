@@ -32,6 +32,44 @@ public:
     bool fast_mode = {false};
     bool pause_on_quit = {false};
 
+    bool model_128k = {false};
+
+    uint32_t speed = {1};  // 0 runs as fast as possible
+    bool auto_warp = {false};
+
+    bool headless = {false};
+    uint64_t max_frames = {0};  // 0 runs until stopped
+
+    std::string dump_frames_prefix = {""};
+    bool dump_frames_on = {false};
+
+    std::string frame_hashes_file = {""};
+    bool frame_hashes_on = {false};
+
+    std::string audio_file = {""};
+    bool audio_file_on = {false};
+
+    std::string video_file = {""};
+    bool video_file_on = {false};
+    uint32_t video_skip = {1};
+
+    std::string profile_opcodes_file = {""};
+    bool profile_opcodes_on = {false};
+
+    std::string profile_pc_file = {""};
+    bool profile_pc_on = {false};
+
+    std::string profile_calls_file = {""};
+    bool profile_calls_on = {false};
+
+    uint64_t host_profile_interval = {0};
+
+    std::string trace_file = {""};
+    bool trace_on = {false};
+
+    std::string symbols_file = {""};
+    bool symbols_on = {false};
+
 private:
     Options() = delete;
 
@@ -0,0 +1,94 @@
+/**
+ * @brief Header defining the lock-free ring buffer used to hand audio samples to the audio device.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief Single producer, single consumer ring of audio samples.
+ * Neither side ever waits for the other. Samples that do not fit are dropped and counted as an overrun, a read that
+ * cannot be filled is counted as an underrun. The counters may be read from any thread.
+ */
+class SampleRing {
+public:
+    // The capacity is rounded up to a power of two so positions wrap with a mask
+    explicit SampleRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        samples.resize(size);
+        mask = size - 1;
+    }
+    virtual ~SampleRing() {}
+
+    // Producer side
+    /**
+     * @brief Append up to count samples, returning how many fit.
+     */
+    size_t write(const int16_t *in, size_t count) {
+        size_t head = write_pos.load(std::memory_order_relaxed);
+        size_t space = samples.size() - (head - read_pos.load(std::memory_order_acquire));
+        if (count > space) {
+            overrun_count.fetch_add(1, std::memory_order_relaxed);
+            count = space;
+        }
+
+        copy_in(head & mask, in, count);
+        write_pos.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side
+    /**
+     * @brief Take up to count samples, returning how many there were.
+     */
+    size_t read(int16_t *out, size_t count) {
+        size_t tail = read_pos.load(std::memory_order_relaxed);
+        size_t available = write_pos.load(std::memory_order_acquire) - tail;
+        if (count > available) {
+            underrun_count.fetch_add(1, std::memory_order_relaxed);
+            count = available;
+        }
+
+        copy_out(tail & mask, out, count);
+        read_pos.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t capacity() const { return samples.size(); }
+    size_t available() const {
+        return write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_acquire);
+    }
+    uint64_t overruns() const { return overrun_count.load(std::memory_order_relaxed); }
+    uint64_t underruns() const { return underrun_count.load(std::memory_order_relaxed); }
+
+private:
+    void copy_in(size_t pos, const int16_t *in, size_t count) {
+        size_t first = std::min(count, samples.size() - pos);
+        std::memcpy(samples.data() + pos, in, first * sizeof(int16_t));
+        std::memcpy(samples.data(), in + first, (count - first) * sizeof(int16_t));
+    }
+    void copy_out(size_t pos, int16_t *out, size_t count) const {
+        size_t first = std::min(count, samples.size() - pos);
+        std::memcpy(out, samples.data() + pos, first * sizeof(int16_t));
+        std::memcpy(out + first, samples.data(), (count - first) * sizeof(int16_t));
+    }
+
+    std::vector<int16_t> samples;
+    size_t mask = {0};
+
+    // Positions only ever increase, each is written by one side. Kept on separate cache lines so the two threads do
+    // not contend for them.
+    alignas(64) std::atomic<size_t> write_pos = {0};
+    alignas(64) std::atomic<size_t> read_pos = {0};
+    alignas(64) std::atomic<uint64_t> overrun_count = {0};
+    std::atomic<uint64_t> underrun_count = {0};
+};
@@ -0,0 +1,171 @@
+/**
+ * @brief Implementation of the display memory to ARGB conversion kernels.
+ */
+
+#include "screen.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JRNZ_SCREEN_X86 1
+#endif
+
+const std::array<uint32_t, 16> screen_palette = {
+    0xff000000, 0xff0000d7, 0xffd70000, 0xffd700d7, 0xff00d700, 0xff00d7d7, 0xffd7d700, 0xffd7d7d7,
+    0xff000000, 0xff0000ff, 0xffff0000, 0xffff00ff, 0xff00ff00, 0xff00ffff, 0xffffff00, 0xffffffff,
+};
+
+static constexpr std::array<uint16_t, 192> make_line_offsets() {
+    std::array<uint16_t, 192> offsets = {};
+    // Display lines are interleaved by character row within each third of the screen
+    for (int y = 0; y < 192; y++) {
+        offsets[y] = static_cast<uint16_t>(((y & 0xc0) << 5) | ((y & 0x7) << 8) | ((y & 0x38) << 2));
+    }
+    return offsets;
+}
+
+const std::array<uint16_t, 192> screen_line_offsets = make_line_offsets();
+
+/**
+ * @brief Ink and paper colour for every attribute byte in both flash phases.
+ */
+struct AttributeColours {
+    std::array<std::array<uint32_t, 256>, 2> ink;
+    std::array<std::array<uint32_t, 256>, 2> paper;
+
+    AttributeColours() {
+        for (int attr = 0; attr < 256; attr++) {
+            int bright = (attr & 0x40) >> 3;
+            uint32_t ink_colour = screen_palette[bright | (attr & 0x7)];
+            uint32_t paper_colour = screen_palette[bright | ((attr >> 3) & 0x7)];
+            bool flash = (attr & 0x80) != 0;
+
+            ink[0][attr] = ink_colour;
+            paper[0][attr] = paper_colour;
+            ink[1][attr] = flash ? paper_colour : ink_colour;
+            paper[1][attr] = flash ? ink_colour : paper_colour;
+        }
+    }
+};
+
+static const AttributeColours attribute_colours;
+
+static void expand_span_scalar(const uint8_t *pixels, const uint8_t *attrs, size_t count, bool flash_invert,
+                               uint32_t *out) {
+    const uint32_t *ink_lut = attribute_colours.ink[flash_invert].data();
+    const uint32_t *paper_lut = attribute_colours.paper[flash_invert].data();
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t ink = ink_lut[attrs[i]];
+        uint32_t paper = paper_lut[attrs[i]];
+        uint8_t byte = pixels[i];
+        for (int p = 0; p < 8; p++) {
+            *out++ = (byte & (0x80 >> p)) ? ink : paper;
+        }
+    }
+}
+
+#ifdef JRNZ_SCREEN_X86
+__attribute__((target("sse2"))) static void expand_span_sse2(const uint8_t *pixels, const uint8_t *attrs,
+                                                             size_t count, bool flash_invert, uint32_t *out) {
+    const uint32_t *ink_lut = attribute_colours.ink[flash_invert].data();
+    const uint32_t *paper_lut = attribute_colours.paper[flash_invert].data();
+    const __m128i bits_hi = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    const __m128i bits_lo = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+
+    for (size_t i = 0; i < count; i++) {
+        __m128i ink = _mm_set1_epi32(static_cast<int>(ink_lut[attrs[i]]));
+        __m128i paper = _mm_set1_epi32(static_cast<int>(paper_lut[attrs[i]]));
+        __m128i byte = _mm_set1_epi32(pixels[i]);
+
+        __m128i mask_hi = _mm_cmpeq_epi32(_mm_and_si128(byte, bits_hi), bits_hi);
+        __m128i mask_lo = _mm_cmpeq_epi32(_mm_and_si128(byte, bits_lo), bits_lo);
+        __m128i out_hi = _mm_or_si128(_mm_and_si128(mask_hi, ink), _mm_andnot_si128(mask_hi, paper));
+        __m128i out_lo = _mm_or_si128(_mm_and_si128(mask_lo, ink), _mm_andnot_si128(mask_lo, paper));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), out_hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4), out_lo);
+        out += 8;
+    }
+}
+
+__attribute__((target("avx2"))) static void expand_span_avx2(const uint8_t *pixels, const uint8_t *attrs,
+                                                             size_t count, bool flash_invert, uint32_t *out) {
+    const uint32_t *ink_lut = attribute_colours.ink[flash_invert].data();
+    const uint32_t *paper_lut = attribute_colours.paper[flash_invert].data();
+    const __m256i bits = _mm256_set_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+
+    for (size_t i = 0; i < count; i++) {
+        __m256i ink = _mm256_set1_epi32(static_cast<int>(ink_lut[attrs[i]]));
+        __m256i paper = _mm256_set1_epi32(static_cast<int>(paper_lut[attrs[i]]));
+        __m256i byte = _mm256_set1_epi32(pixels[i]);
+
+        __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(byte, bits), bits);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_blendv_epi8(paper, ink, mask));
+        out += 8;
+    }
+}
+#endif
+
+bool screen_kernel_supported(ScreenKernel kernel) {
+    switch (kernel) {
+        case ScreenKernel::Scalar:
+            return true;
+#ifdef JRNZ_SCREEN_X86
+        case ScreenKernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case ScreenKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+ScreenKernel best_screen_kernel() {
+    static const ScreenKernel best = []() {
+        if (screen_kernel_supported(ScreenKernel::AVX2)) {
+            return ScreenKernel::AVX2;
+        }
+        if (screen_kernel_supported(ScreenKernel::SSE2)) {
+            return ScreenKernel::SSE2;
+        }
+        return ScreenKernel::Scalar;
+    }();
+    return best;
+}
+
+const char *screen_kernel_name(ScreenKernel kernel) {
+    switch (kernel) {
+        case ScreenKernel::SSE2:
+            return "sse2";
+        case ScreenKernel::AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+void expand_span(ScreenKernel kernel, const uint8_t *pixels, const uint8_t *attrs, size_t count, bool flash_invert,
+                 uint32_t *out) {
+    switch (kernel) {
+#ifdef JRNZ_SCREEN_X86
+        case ScreenKernel::SSE2:
+            expand_span_sse2(pixels, attrs, count, flash_invert, out);
+            break;
+        case ScreenKernel::AVX2:
+            expand_span_avx2(pixels, attrs, count, flash_invert, out);
+            break;
+#endif
+        default:
+            expand_span_scalar(pixels, attrs, count, flash_invert, out);
+            break;
+    }
+}
+
+void expand_screen(ScreenKernel kernel, const uint8_t *display, bool flash_invert, uint32_t *out, size_t stride) {
+    const uint8_t *attrs = display + 0x1800;
+    for (int y = 0; y < 192; y++) {
+        expand_span(kernel, display + screen_line_offsets[y], attrs + (y >> 3) * 32, 32, flash_invert,
+                    out + y * stride);
+    }
+}
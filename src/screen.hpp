@@ -0,0 +1,37 @@
+/**
+ * @brief Header defining the display memory to ARGB conversion kernels.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Implementations of the bitmap and attribute expansion. The vector versions are only available on x86 hosts
+ * and are chosen at runtime from what the CPU supports.
+ */
+enum class ScreenKernel { Scalar, SSE2, AVX2 };
+
+// ARGB8888 colours indexed by bright << 3 | colour
+extern const std::array<uint32_t, 16> screen_palette;
+
+// Offset from the start of display memory of the bitmap for each of the 192 display lines
+extern const std::array<uint16_t, 192> screen_line_offsets;
+
+bool screen_kernel_supported(ScreenKernel kernel);
+ScreenKernel best_screen_kernel();
+const char *screen_kernel_name(ScreenKernel kernel);
+
+/**
+ * @brief Expand count bitmap bytes and their attributes into count * 8 ARGB pixels.
+ * Set flash_invert during the inverted half of the flash cycle to swap ink and paper of flashing cells.
+ */
+void expand_span(ScreenKernel kernel, const uint8_t *pixels, const uint8_t *attrs, size_t count, bool flash_invert,
+                 uint32_t *out);
+
+/**
+ * @brief Convert the 6912 bytes of display memory into 192 lines of 256 pixels, stride pixels apart.
+ */
+void expand_screen(ScreenKernel kernel, const uint8_t *display, bool flash_invert, uint32_t *out, size_t stride);
@@ -0,0 +1,312 @@
+/**
+ * @brief Implementation of the job server.
+ */
+
+#include "server.hpp"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "batch.hpp"
+#include "frame_dump.hpp"
+
+static std::string error_response(const std::string &error) {
+    return "{\"status\": \"error\", \"error\": " + json_string(error) + "}";
+}
+
+JobServer::~JobServer() {
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+}
+
+bool JobServer::listen(const std::string &path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path \'" << path << "\' is too long" << std::endl;
+        return false;
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Unable to create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // A socket left behind by a server that did not shut down cleanly would stop the bind
+    unlink(path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd, 16) != 0) {
+        std::cerr << "Unable to listen on \'" << path << "\': " << std::strerror(errno) << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    socket_path = path;
+    return true;
+}
+
+void JobServer::serve() {
+    while (!stopping) {
+        // Wake up regularly to notice stop requests
+        pollfd pfd = {listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        connection_fds.insert(fd);
+        std::thread(&JobServer::serve_connection, this, fd).detach();
+    }
+
+    // Unblock connections waiting for their next request and wait for them to finish
+    std::unique_lock<std::mutex> lock(connections_mutex);
+    for (int fd : connection_fds) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    connections_closed.wait(lock, [this]() { return connection_fds.empty(); });
+}
+
+void JobServer::serve_connection(int fd) {
+    std::string pending;
+    char buffer[4096];
+
+    for (;;) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count <= 0) {
+            break;
+        }
+        pending.append(buffer, static_cast<size_t>(count));
+
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            std::string response = handle_request(pending.substr(0, newline)) + "\n";
+            pending.erase(0, newline + 1);
+
+            for (size_t sent = 0; sent < response.size();) {
+                ssize_t written = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (written <= 0) {
+                    break;
+                }
+                sent += static_cast<size_t>(written);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    connection_fds.erase(fd);
+    close(fd);
+    connections_closed.notify_all();
+}
+
+std::string JobServer::handle_request(const std::string &line) {
+    std::istringstream tokens(line);
+    std::string verb;
+    if (!(tokens >> verb)) {
+        return error_response("empty request");
+    }
+
+    std::map<std::string, std::string> args;
+    std::string token;
+    while (tokens >> token) {
+        size_t equals = token.find('=');
+        if (equals == std::string::npos) {
+            return error_response("expected key=value, got \'" + token + "\'");
+        }
+        args[token.substr(0, equals)] = token.substr(equals + 1);
+    }
+
+    requests++;
+    if (verb == "ping") {
+        return "{\"status\": \"ok\"}";
+    } else if (verb == "run") {
+        return run(args);
+    } else if (verb == "stats") {
+        return stats();
+    } else if (verb == "shutdown") {
+        stop();
+        return "{\"status\": \"ok\"}";
+    }
+    return error_response("unknown request \'" + verb + "\'");
+}
+
+std::string JobServer::run(const std::map<std::string, std::string> &args) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto arg = [&args](const char *key, const std::string &fallback) {
+        auto it = args.find(key);
+        return (it != args.end()) ? it->second : fallback;
+    };
+
+    std::string file = arg("file", "");
+    if (file.empty()) {
+        return error_response("run needs file=<snapshot>");
+    }
+    uint64_t frames = 0;
+    uint64_t hold = 0;
+    if (!parse_frame_count(arg("frames", "50"), frames) ||
+        !parse_frame_count(arg("hold", std::to_string(frames)), hold)) {
+        return error_response("frames and hold are counts of up to 4294967295 frames");
+    }
+
+    std::vector<std::pair<uint8_t, uint8_t>> keys;
+    std::istringstream key_list(arg("keys", ""));
+    std::string key;
+    while (std::getline(key_list, key, ',')) {
+        char *end = nullptr;
+        unsigned long row = strtoul(key.c_str(), &end, 0);
+        if (*end != ':' || row > 7) {
+            return error_response("keys are <row>:<mask> with rows 0-7, got \'" + key + "\'");
+        }
+        keys.emplace_back(static_cast<uint8_t>(row), static_cast<uint8_t>(strtoul(end + 1, nullptr, 0)));
+    }
+
+    uint16_t ram_addr = 0;
+    size_t ram_count = 0;
+    std::string ram = arg("ram", "");
+    if (!ram.empty()) {
+        char *end = nullptr;
+        ram_addr = static_cast<uint16_t>(strtoul(ram.c_str(), &end, 0));
+        if (*end != ':') {
+            return error_response("ram is <addr>:<count>");
+        }
+        ram_count = std::min<size_t>(strtoul(end + 1, nullptr, 0), 0x10000);
+    }
+
+    // Screenshots are only written to the directory the server was given, under a plain file name
+    std::string screenshot = arg("screenshot", "");
+    if (!screenshot.empty()) {
+        if (screenshot_dir.empty()) {
+            return error_response("screenshots are disabled, start the server with --screenshot-dir");
+        }
+        if (screenshot.find('/') != std::string::npos || screenshot == "." || screenshot == "..") {
+            return error_response("screenshot is a file name without a directory");
+        }
+        screenshot = (std::filesystem::path(screenshot_dir) / screenshot).string();
+    }
+
+    std::vector<uint8_t> state;
+    std::string error;
+    if (!snapshot_state(file, state, error)) {
+        return error_response(error);
+    }
+
+    std::unique_ptr<Machine> machine = acquire_machine();
+    // Cached states were saved by this server, so they skip the scratch machine an untrusted state is tried on
+    if (!machine->restore_trusted_state(state.data(), state.size())) {
+        // The machine may be left part way through restoring, so it is not returned to the pool
+        return error_response("unable to restore the snapshot state");
+    }
+    machine->keys().clear();
+    for (const auto &[row, mask] : keys) {
+        machine->set_key_row(row, mask);
+    }
+
+    BatchResult result;
+    result.file = file;
+    result.frames = machine->run_frames(static_cast<uint32_t>(std::min(hold, frames)));
+    if (frames > hold && result.frames == hold) {
+        machine->keys().clear();
+        result.frames += machine->run_frames(static_cast<uint32_t>(frames - hold));
+    }
+    frames_run += result.frames;
+
+    result.status = (result.frames == frames) ? "ok" : "stopped";
+    result.frame_hash = FrameDumper::hash(machine->framebuffer(), ULA::frame_width * ULA::frame_height);
+    result.ram_hash = machine->memory_hash();
+    result.pc = machine->cpu().pc.get();
+
+    if (!screenshot.empty()) {
+        FrameDumper::write_ppm(screenshot, machine->framebuffer(), ULA::frame_width, ULA::frame_height);
+    }
+
+    std::stringstream ram_hex;
+    for (size_t i = 0; i < ram_count; i++) {
+        ram_hex << std::hex << std::setw(2) << std::setfill('0')
+                << static_cast<int>(machine->read_memory(static_cast<uint16_t>(ram_addr + i)));
+    }
+    release_machine(std::move(machine));
+
+    result.milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::string response = batch_result_json(result);
+    if (ram_count > 0) {
+        response.pop_back();
+        response += ", \"ram\": \"" + ram_hex.str() + "\"}";
+    }
+    return response;
+}
+
+std::string JobServer::stats() const {
+    std::stringstream out;
+    out << "{\"status\": \"ok\", \"requests\": " << requests << ", \"frames\": " << frames_run
+        << ", \"cache_hits\": " << cache_hits << "}";
+    return out.str();
+}
+
+std::unique_ptr<Machine> JobServer::acquire_machine() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (!idle_machines.empty()) {
+            std::unique_ptr<Machine> machine = std::move(idle_machines.back());
+            idle_machines.pop_back();
+            return machine;
+        }
+    }
+    return std::make_unique<Machine>();
+}
+
+void JobServer::release_machine(std::unique_ptr<Machine> machine) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    idle_machines.push_back(std::move(machine));
+}
+
+bool JobServer::snapshot_state(const std::string &file, std::vector<uint8_t> &state, std::string &error) {
+    std::error_code ec;
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(file, ec);
+    if (ec) {
+        error = "unable to open file";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = snapshots.find(file);
+    if (it != snapshots.end() && it->second.modified == modified) {
+        cache_hits++;
+        state = it->second.state;
+        return true;
+    }
+
+    Machine machine;
+    if (!rom.empty()) {
+        machine.load_rom(rom.data(), rom.size());
+    }
+    if (!load_snapshot_file(machine, file, error)) {
+        return false;
+    }
+
+    state = machine.save_state();
+    snapshots[file] = CachedSnapshot{modified, state};
+    return true;
+}
@@ -0,0 +1,92 @@
+/**
+ * @brief Header defining the job server that runs requests in warm machines over a Unix domain socket.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "machine.hpp"
+
+/**
+ * @brief Serves requests of one line each, answering every request with one line of JSON.
+ *
+ *   ping
+ *   run file=<snapshot> [frames=<n>] [keys=<row>:<mask>[,<row>:<mask>...]] [hold=<frames>] [ram=<addr>:<count>]
+ *       [screenshot=<file.ppm>]
+ *   stats
+ *   shutdown
+ *
+ * Each run starts from a fresh copy of the snapshot. Keys are held for hold frames (all of them by default), ram
+ * returns the bytes read after the run as hex and screenshot writes the last frame to a file of that name in
+ * screenshot_dir, refused when no directory is set. Loaded snapshots are cached as
+ * machine states and idle machines are kept for reuse, so a request costs little more than the frames it runs.
+ */
+class JobServer {
+public:
+    JobServer(const std::vector<uint8_t> &_rom) : rom(_rom) {}
+    virtual ~JobServer();
+
+    bool listen(const std::string &path);
+
+    /**
+     * @brief Accept connections until stop() is called or a shutdown request arrives. Each connection is served on
+     * a thread of its own.
+     */
+    void serve();
+    void stop() { stopping = true; }
+
+    std::string handle_request(const std::string &line);
+
+    // Directory screenshots are written to, empty to refuse them
+    std::string screenshot_dir = {""};
+
+private:
+    std::string run(const std::map<std::string, std::string> &args);
+    std::string stats() const;
+
+    std::unique_ptr<Machine> acquire_machine();
+    void release_machine(std::unique_ptr<Machine> machine);
+    bool snapshot_state(const std::string &file, std::vector<uint8_t> &state, std::string &error);
+
+    void serve_connection(int fd);
+
+    /**
+     * @brief Machine state just after loading a snapshot, reloaded when the file changes.
+     */
+    struct CachedSnapshot {
+        std::filesystem::file_time_type modified;
+        std::vector<uint8_t> state;
+    };
+
+    const std::vector<uint8_t> &rom;
+
+    std::mutex pool_mutex;
+    std::vector<std::unique_ptr<Machine>> idle_machines;
+
+    std::mutex cache_mutex;
+    std::map<std::string, CachedSnapshot> snapshots;
+
+    std::atomic<uint64_t> requests = {0};
+    std::atomic<uint64_t> frames_run = {0};
+    std::atomic<uint64_t> cache_hits = {0};
+
+    std::string socket_path;
+    int listen_fd = {-1};
+    std::atomic<bool> stopping = {false};
+
+    // Connection threads are detached, serve() waits for the set to empty before returning
+    std::mutex connections_mutex;
+    std::condition_variable connections_closed;
+    std::set<int> connection_fds;
+};
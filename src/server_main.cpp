@@ -0,0 +1,97 @@
+/**
+ * @brief Entry point of jrnz-server, which answers job requests from a Unix domain socket using warm machines.
+ */
+
+#include <getopt.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "server.hpp"
+
+static JobServer *running_server = nullptr;
+
+static void handle_stop_signal(int sig) {
+    (void)sig;
+    if (running_server != nullptr) {
+        running_server->stop();
+    }
+}
+
+static void print_help(const char *name) {
+    std::cout << "Run: " << name << " --socket <path> [--rom <filename>] [--screenshot-dir <dir>]\n";
+    std::cout << "\t--help                 - displays this help\n";
+    std::cout << "\t--socket <path>        - Listen for requests on the Unix domain socket at <path>\n";
+    std::cout << "\t--rom <filename>       - Loads the specified ROM file into every machine (at address 0)\n";
+    std::cout << "\t--screenshot-dir <dir> - Directory screenshot=<file.ppm> requests write to, refused without it\n";
+    std::cout << "Requests are single lines, see jrnz-client for examples:\n";
+    std::cout << "\tping | stats | shutdown\n";
+    std::cout << "\trun file=<snapshot> [frames=<n>] [keys=<row>:<mask>,...] [hold=<frames>] "
+                 "[ram=<addr>:<count>] [screenshot=<file.ppm>]\n";
+}
+
+int main(int argc, char **argv) {
+    static struct option long_options[] = {{"help", no_argument, 0, 'h'},
+                                           {"socket", required_argument, 0, 's'},
+                                           {"rom", required_argument, 0, 'r'},
+                                           {"screenshot-dir", required_argument, 0, 'd'},
+                                           {0, 0, 0, 0}};
+
+    std::string socket_path;
+    std::string rom_file;
+    std::string screenshot_dir;
+    int c;
+    while ((c = getopt_long(argc, argv, "hs:r:d:", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'h':
+                print_help(argv[0]);
+                return EXIT_SUCCESS;
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'r':
+                rom_file = optarg;
+                break;
+            case 'd':
+                screenshot_dir = optarg;
+                break;
+        }
+    }
+
+    if (socket_path.empty()) {
+        std::cerr << "No socket path given, see --help\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> rom;
+    if (!rom_file.empty()) {
+        std::ifstream rom_in(rom_file, std::ios::binary);
+        if (!rom_in) {
+            std::cerr << "No ROM file found called " << rom_file << std::endl;
+            return EXIT_FAILURE;
+        }
+        rom.assign(std::istreambuf_iterator<char>(rom_in), std::istreambuf_iterator<char>());
+    }
+
+    JobServer server(rom);
+    server.screenshot_dir = screenshot_dir;
+    if (!server.listen(socket_path)) {
+        return EXIT_FAILURE;
+    }
+
+    running_server = &server;
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+
+    std::cout << "Listening on " << socket_path << std::endl;
+    server.serve();
+    std::cout << "Server stopped.\n";
+
+    running_server = nullptr;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+/**
+ * @brief Header defining the helpers used to save and restore machine state.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Appends plain values to a state buffer.
+ * Values are stored in host byte order, so a saved state is only meant to be restored by the same build.
+ */
+class StateWriter {
+public:
+    StateWriter() {}
+    virtual ~StateWriter() {}
+
+    template <typename T>
+    void put(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "state values must be plain data");
+        put_bytes(reinterpret_cast<const uint8_t *>(&value), sizeof(T));
+    }
+    void put_bytes(const uint8_t *bytes, size_t count) {
+        size_t pos = data.size();
+        data.resize(pos + count);
+        std::memcpy(data.data() + pos, bytes, count);
+    }
+
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Reads values back in the order they were written. Once a read runs past the end every later read fails.
+ */
+class StateReader {
+public:
+    StateReader(const uint8_t *_data, size_t _size) : data(_data), size(_size) {}
+    virtual ~StateReader() {}
+
+    template <typename T>
+    bool get(T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "state values must be plain data");
+        return get_bytes(reinterpret_cast<uint8_t *>(&value), sizeof(T));
+    }
+    bool get_bytes(uint8_t *bytes, size_t count) {
+        if (!valid || count > size - pos) {
+            valid = false;
+            return false;
+        }
+        std::memcpy(bytes, data + pos, count);
+        pos += count;
+        return true;
+    }
+
+    bool ok() const { return valid; }
+    bool at_end() const { return pos == size; }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t pos = {0};
+    bool valid = {true};
+};
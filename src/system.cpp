@@ -12,15 +12,24 @@ bool System::clock() {
         do_break = false;
     }
 
-    if (_debugger.clock()) {
-        uint64_t cycle_count = 1;
-        bool is_beeper_on = (_bus.port_254 >> 4) & 0x1;
-        bool is_mic_on = !static_cast<bool>(((_bus.port_254) >> 3) & 0x1);
-        _beeper.clock(is_beeper_on, is_mic_on, cycle_count);
+    // Only time the debugger and Z80 on instruction boundaries, the T-states in between just count down
+    bool debugger_ok = false;
+    {
+        HOST_PROFILE_SCOPE_IF(host_profiler, Debugger, _z80.cycles_left == 0);
+        debugger_ok = _debugger.clock();
+    }
 
+    if (debugger_ok) {
         _bus.clock();
         _ula.clock(do_exit, do_break);
-        // _beeper.clock(false, false, 0);
+        if (_bus.frame_tstate == 0) {
+            // The ULA has just finished a frame, the beeper was told of each port write as it happened. Sound faster
+            // than real time would only be garbled, so it is muted.
+            _beeper.muted = _ula.warping();
+            _beeper.end_frame(_ula.frame_length());
+        }
+
+        HOST_PROFILE_SCOPE_IF(host_profiler, Z80, _z80.cycles_left == 0);
         return _z80.clock(_debugger.is_break_enabled()) && !do_exit;
     }
     return false;
@@ -9,6 +9,7 @@
 #include "beeper.hpp"
 #include "bus.hpp"
 #include "debugger.hpp"
+#include "host_profiler.hpp"
 #include "ula.hpp"
 #include "z80.hpp"
 
@@ -18,7 +19,9 @@
 class System {
 public:
     System(Z80 &_z80, ULA &_ula, Bus &_bus, Debugger &_debugger, Beeper &_beeper)
-        : _z80(_z80), _ula(_ula), _bus(_bus), _debugger(_debugger), _beeper(_beeper) {}
+        : _z80(_z80), _ula(_ula), _bus(_bus), _debugger(_debugger), _beeper(_beeper) {
+        _bus.beeper = &_beeper;
+    }
     virtual ~System() {}
 
     bool clock();
@@ -28,6 +31,8 @@ public:
     Bus &bus() { return _bus; }
     Debugger &debugger() { return _debugger; }
 
+    HostProfiler *host_profiler = {nullptr};
+
 private:
     Z80 &_z80;
     ULA &_ula;
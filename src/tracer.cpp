@@ -0,0 +1,86 @@
+/**
+ * @brief Implementation of the Chrome trace-event writer.
+ */
+
+#include "tracer.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+bool Tracer::open(const std::string &filename) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    out.open(filename);
+    if (!out) {
+        std::cerr << "Unable to write trace to \'" << filename << "\'" << std::endl;
+        return false;
+    }
+
+    out << "[\n";
+    out << std::fixed << std::setprecision(3);
+    first_event = true;
+    return true;
+}
+
+void Tracer::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (out.is_open()) {
+        out << "\n]\n";
+        out.close();
+    }
+}
+
+uint32_t Tracer::thread_id() {
+    auto it = thread_ids.find(std::this_thread::get_id());
+    if (it != thread_ids.end()) {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(thread_ids.size()) + 1;
+    thread_ids.emplace(std::this_thread::get_id(), id);
+    return id;
+}
+
+void Tracer::begin_event() {
+    if (!first_event) {
+        out << ",\n";
+    }
+    first_event = false;
+}
+
+void Tracer::set_thread_name(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!out.is_open()) {
+        return;
+    }
+
+    begin_event();
+    out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread_id()
+        << ", \"args\": {\"name\": \"" << name << "\"}}";
+}
+
+void Tracer::complete(const char *name, const char *category, clock::time_point start, clock::time_point end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!out.is_open()) {
+        return;
+    }
+
+    begin_event();
+    out << "{\"name\": \"" << name << "\", \"cat\": \"" << category << "\", \"ph\": \"X\", \"ts\": " << to_us(start)
+        << ", \"dur\": " << std::chrono::duration<double, std::micro>(end - start).count()
+        << ", \"pid\": 1, \"tid\": " << thread_id() << "}";
+}
+
+void Tracer::instant(const char *name, const char *category) {
+    clock::time_point now = clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!out.is_open()) {
+        return;
+    }
+
+    begin_event();
+    out << "{\"name\": \"" << name << "\", \"cat\": \"" << category << "\", \"ph\": \"i\", \"s\": \"t\", \"ts\": "
+        << to_us(now) << ", \"pid\": 1, \"tid\": " << thread_id() << "}";
+}
@@ -0,0 +1,70 @@
+/**
+ * @brief Header defining the Chrome trace-event writer.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Writes a timeline of host events in Chrome Trace Event format.
+ * The output can be loaded into Perfetto or chrome://tracing. Events may be written from any thread.
+ */
+class Tracer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Records a complete event covering the lifetime of the span.
+     */
+    class Span {
+    public:
+        Span(Tracer *_tracer, const char *_name, const char *_category)
+            : tracer(_tracer), name(_name), category(_category) {
+            if (tracer != nullptr) {
+                start = clock::now();
+            }
+        }
+        ~Span() {
+            if (tracer != nullptr) {
+                tracer->complete(name, category, start, clock::now());
+            }
+        }
+
+    private:
+        Tracer *tracer;
+        const char *name;
+        const char *category;
+        clock::time_point start;
+    };
+
+    Tracer() : origin(clock::now()) {}
+    virtual ~Tracer() { close(); }
+
+    bool open(const std::string &filename);
+    void close();
+    bool is_open() const { return out.is_open(); }
+
+    void set_thread_name(const std::string &name);
+    void complete(const char *name, const char *category, clock::time_point start, clock::time_point end);
+    void instant(const char *name, const char *category);
+
+private:
+    uint32_t thread_id();
+    double to_us(clock::time_point t) const {
+        return std::chrono::duration<double, std::micro>(t - origin).count();
+    }
+    void begin_event();
+
+    std::mutex mutex;
+    std::ofstream out;
+    clock::time_point origin;
+    bool first_event = {true};
+    std::map<std::thread::id, uint32_t> thread_ids;
+};
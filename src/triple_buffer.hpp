@@ -0,0 +1,60 @@
+/**
+ * @brief Header defining the lock-free triple buffer used to hand frames to the display.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Single producer, single consumer triple buffer of frames.
+ * The producer always has a buffer to write into and never waits for the consumer. If the consumer has not taken the
+ * previous frame by the time the next is published the older frame is dropped.
+ */
+class TripleBuffer {
+public:
+    explicit TripleBuffer(size_t size) {
+        for (auto &buffer : buffers) {
+            buffer.resize(size);
+        }
+    }
+    virtual ~TripleBuffer() {}
+
+    // Producer side
+    uint32_t *back() { return buffers[back_index].data(); }
+
+    /**
+     * @brief Make the back buffer the latest frame. Returns true if an unconsumed frame was dropped to do so.
+     */
+    bool publish() {
+        uint8_t old = middle.exchange(back_index | fresh_bit, std::memory_order_acq_rel);
+        back_index = old & index_mask;
+        return (old & fresh_bit) != 0;
+    }
+
+    // Consumer side
+    /**
+     * @brief Take the latest frame if one was published since the last call.
+     */
+    bool acquire() {
+        if ((middle.load(std::memory_order_relaxed) & fresh_bit) == 0) {
+            return false;
+        }
+        front_index = middle.exchange(front_index, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+    const uint32_t *front() const { return buffers[front_index].data(); }
+
+private:
+    static constexpr uint8_t index_mask = 0x3;
+    static constexpr uint8_t fresh_bit = 0x4;
+
+    std::array<std::vector<uint32_t>, 3> buffers;
+    std::atomic<uint8_t> middle = {1};
+    uint8_t back_index = {0};   // Only touched by the producer
+    uint8_t front_index = {2};  // Only touched by the consumer
+};
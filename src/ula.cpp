@@ -4,96 +4,210 @@
 
 #include "ula.hpp"
 
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_surface.h>
-#include <SDL2/SDL_timer.h>
+#include <time.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdint>
 
 #include "common.hpp"
 
-extern SDL_Window *window;
-extern SDL_Renderer *renderer;
-
-#ifdef HAVE_DISPLAY
-static bool get_bit(uint8_t byte, uint8_t pos) { return (byte & (1 << pos)) != 0; }
-
-static void set_rendercolor(SDL_Renderer *renderer, uint8_t color, bool bright) {
-    if (bright) {
-        switch (color) {
-            case 0:
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-                break;
-            case 1:
-                SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
-                break;
-            case 2:
-                SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
-                break;
-            case 3:
-                SDL_SetRenderDrawColor(renderer, 255, 0, 255, SDL_ALPHA_OPAQUE);
-                break;
-            case 4:
-                SDL_SetRenderDrawColor(renderer, 0, 255, 0, SDL_ALPHA_OPAQUE);
-                break;
-            case 5:
-                SDL_SetRenderDrawColor(renderer, 0, 255, 255, SDL_ALPHA_OPAQUE);
-                break;
-            case 6:
-                SDL_SetRenderDrawColor(renderer, 255, 255, 0, SDL_ALPHA_OPAQUE);
-                break;
-            case 7:
-                SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-                break;
+/**
+ * @brief Sleep until an absolute time on the monotonic clock, which steady_clock is read from. Sleeping to a deadline
+ * rather than for a duration means late wake-ups do not add up from frame to frame.
+ */
+static void sleep_until(std::chrono::steady_clock::time_point deadline) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    timespec when = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, nullptr) == EINTR) {
+    }
+}
+
+void ULA::draw_chunks(int fy, int first, int last) {
+    uint32_t *line = framebuffer.data() + fy * frame_width;
+    uint32_t border = screen_palette[shadow_border];
+    int y = fy - border_size;
+
+    if (y < 0 || y >= screen_height) {
+        std::fill(line + first * 8, line + last * 8, border);
+        return;
+    }
+
+    // Chunks 4 to 35 cover the 32 display columns, the rest are side border
+    const int display_first = border_size / 8;
+    const int display_last = display_first + 32;
+    if (first < display_first) {
+        std::fill(line + first * 8, line + std::min(last, display_first) * 8, border);
+    }
+    if (last > display_last) {
+        std::fill(line + std::max(first, display_last) * 8, line + last * 8, border);
+    }
+
+    int col_first = std::max(first, display_first);
+    int col_last = std::min(last, display_last);
+    if (col_first < col_last) {
+        int col = col_first - display_first;
+        expand_span(kernel, shadow.data() + screen_line_offsets[y] + col, shadow.data() + 0x1800 + (y >> 3) * 32 + col,
+                    col_last - col_first, rendered_invert, line + col_first * 8);
+    }
+}
+
+bool ULA::render_frame() {
+    // The frame is rebuilt in raster order from a copy of display memory as it was at the start of the frame,
+    // applying each logged screen and border write when the beam reaches the time it happened. Character rows
+    // that were not written this frame or last frame are left as they are.
+    _bus.resolve_screen_log();
+    const std::vector<Bus::ScreenWrite> &log = _bus.screen_log();
+    std::array<uint32_t, 24> &dirty_rows = _bus.screen_dirty_rows();
+
+    bool reset = _bus.take_screen_reset();
+    if (reset) {
+        _bus.read_screen(shadow.data(), shadow.size());
+        shadow_border = _bus.port_254 & 0x7;
+        _bus.clear_screen_log();
+    }
+
+    bool flash_flipped = (invert != rendered_invert);
+    rendered_invert = invert;
+
+    uint32_t rows = 0;
+    for (int row = 0; row < 24; row++) {
+        bool flash = false;
+        if (flash_flipped) {
+            for (int col = 0; col < 32 && !flash; col++) {
+                uint16_t attr = static_cast<uint16_t>(0x1800 + row * 32 + col);
+                flash = ((shadow[attr] | _bus.screen_byte(attr)) & 0x80) != 0;
+            }
         }
-    } else {
-        switch (color) {
-            case 0:
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-                break;
-            case 1:
-                SDL_SetRenderDrawColor(renderer, 0, 0, 215, SDL_ALPHA_OPAQUE);
-                break;
-            case 2:
-                SDL_SetRenderDrawColor(renderer, 215, 0, 0, SDL_ALPHA_OPAQUE);
-                break;
-            case 3:
-                SDL_SetRenderDrawColor(renderer, 215, 0, 215, SDL_ALPHA_OPAQUE);
-                break;
-            case 4:
-                SDL_SetRenderDrawColor(renderer, 0, 215, 0, SDL_ALPHA_OPAQUE);
-                break;
-            case 5:
-                SDL_SetRenderDrawColor(renderer, 0, 215, 215, SDL_ALPHA_OPAQUE);
-                break;
-            case 6:
-                SDL_SetRenderDrawColor(renderer, 215, 215, 0, SDL_ALPHA_OPAQUE);
-                break;
-            case 7:
-                SDL_SetRenderDrawColor(renderer, 215, 215, 215, SDL_ALPHA_OPAQUE);
-                break;
+        if (dirty_rows[row] != 0 || flash) {
+            rows |= 1u << row;
+        }
+        dirty_rows[row] = 0;
+    }
+
+    bool border_written = false;
+    for (const Bus::ScreenWrite &write : log) {
+        border_written |= write.is_border;
+    }
+
+    // A row changed mid-frame last time shows a mix of old and new contents, so draw it once more
+    bool border_active = reset || border_written || border_prev;
+    uint32_t render_rows = rows | rows_prev | (border_active ? 0xffffff : 0);
+    rows_prev = rows;
+    border_prev = border_written;
+
+    size_t next = 0;
+    auto apply_until = [&](uint32_t tstate) {
+        for (; next < log.size() && log[next].tstate <= tstate; next++) {
+            if (log[next].is_border) {
+                shadow_border = log[next].value & 0x7;
+            } else {
+                shadow[log[next].offset] = log[next].value;
+            }
+        }
+    };
+
+    for (int fy = 0; fy < frame_height; fy++) {
+        int y = fy - border_size;
+        bool draw = (y < 0 || y >= screen_height) ? border_active : ((render_rows >> (y >> 3)) & 1) != 0;
+
+        // The framebuffer starts border_size pixels (two pixels per T-state) before the display on each line
+        int line_t = static_cast<int>(display_start_tstate) + static_cast<int>(line_tstates) * y - border_size / 2;
+        if (!draw) {
+            apply_until(line_t + line_tstates - 1);
+            continue;
+        }
+
+        // Draw in chunks of 8 pixels (4 T-states), splitting the line wherever a logged write lands
+        int chunk = 0;
+        while (chunk < frame_width / 8) {
+            apply_until(line_t + chunk * 4);
+            int end = frame_width / 8;
+            if (next < log.size() && static_cast<int>(log[next].tstate) < line_t + end * 4) {
+                end = std::max(chunk + 1, (static_cast<int>(log[next].tstate) - line_t + 3) / 4);
+            }
+            draw_chunks(fy, chunk, end);
+            chunk = end;
         }
     }
+
+    apply_until(UINT32_MAX);
+    _bus.clear_screen_log();
+
+    return render_rows != 0;
+}
+
+void ULA::save_state(StateWriter &state) const {
+    state.put(counter);
+    state.put(frame_counter);
+    state.put(invert);
+}
+
+bool ULA::load_state(StateReader &state) {
+    state.get(counter);
+    state.get(frame_counter);
+    state.get(invert);
+    _bus.frame_tstate = static_cast<uint32_t>(counter);
+
+    // The bus marks the whole screen dirty, so the next frame is redrawn from the restored memory
+    rendered_invert = invert;
+    rows_prev = 0;
+    border_prev = false;
+    // The model is set first, a counter past its frame would never reach the end of the frame
+    return state.ok() && counter <= frame_tstates;
+}
+
+bool ULA::tape_loader_running() const {
+    // LD-BYTES up to SAVE-ETC in the 48K BASIC ROM, which the 128K pages in as ROM 1. Sampled once a frame, which is
+    // enough because the loader spends nearly all its time waiting for edges.
+    uint16_t pc = _z80.pc.get();
+    bool basic_rom = _bus.model() == SpectrumModel::ZX48K || (_bus.paging() & 0x10) != 0;
+    return basic_rom && pc >= 0x0556 && pc < 0x0605;
+}
+
+void ULA::set_model(SpectrumModel model) {
+    if (model == SpectrumModel::ZX128K) {
+        frame_tstates = 70908;
+        cpu_clock_hz = 3546900;
+        line_tstates = 228;
+        display_start_tstate = 14364;
+    } else {
+        frame_tstates = 69888;
+        cpu_clock_hz = 3500000;
+        line_tstates = 224;
+        display_start_tstate = 14336;
+    }
+}
+
+void ULA::fork_from(const ULA &parent) {
+    frame_tstates = parent.frame_tstates;
+    line_tstates = parent.line_tstates;
+    display_start_tstate = parent.display_start_tstate;
+    counter = parent.counter;
+    frame_counter = parent.frame_counter;
+    invert = parent.invert;
+    rendered_invert = parent.rendered_invert;
+    shadow = parent.shadow;
+    shadow_border = parent.shadow_border;
+    rows_prev = parent.rows_prev;
+    border_prev = parent.border_prev;
+    framebuffer = parent.framebuffer;
 }
-#endif
 
 void ULA::clock(bool &do_exit, bool &do_break) {
-    if (perf_freq == 0) {
-        perf_freq = SDL_GetPerformanceFrequency();
-        next_frame_deadline = SDL_GetPerformanceCounter() + (perf_freq / 50);
+    if (!fast_mode && !pacing_started) {
+        next_frame_deadline = pacing_clock::now() + frame_period;
+        pacing_started = true;
     }
 
     switch (counter) {
-        case 0: {
-            SDL_PumpEvents();
-            const uint8_t *key_state = static_cast<const uint8_t *>(SDL_GetKeyboardState(NULL));
-
-            if (key_state[SDL_SCANCODE_TAB]) {
+        case 0:
+            // Host events are handled on the display thread which forwards these requests
+            if (break_requested.exchange(false)) {
                 do_break = true;
-            } else if (key_state[SDL_SCANCODE_ESCAPE]) {
+            } else if (exit_requested) {
                 do_exit = true;
             }
-        }
 
             // Trigger interupt on Z80
             _z80.interrupt = true;
@@ -103,90 +217,80 @@ void ULA::clock(bool &do_exit, bool &do_break) {
             // Turn off interrupt
             _z80.interrupt = false;
             break;
+    }
+
+    if (counter == frame_tstates) {
+        // Every 50th of a second reset the counter to start everything again
+        counter = UINT64_MAX;  // will wrap on increment
 
-        case 69888:
-            //! TODO - a bit of a hack, but every 50th of a second (running at 3.5
-            //! Mhz on a 48K)
-            //! reset the counter to start everything again.
-            counter = UINT64_MAX;  // will wrap on increment
+        if (auto_warp && tape_loader_running()) {
+            warp_frames_left = warp_hold_frames;
+        } else if (warp_frames_left > 0) {
+            warp_frames_left--;
+        }
+        frame_speed = (warp_frames_left > 0) ? 0 : speed.load();
+        uint32_t render_every = (frame_speed == 0) ? unlimited_frame_skip : frame_speed;
 
-#ifdef HAVE_DISPLAY
+        bool present = !video_sinks.empty() && frame_counter % render_every == 0;
+        if (!present && recording_sinks.empty()) {
+            // Nobody is watching, so drop the logged writes and resynchronise when a frame is next drawn
+            _bus.clear_screen_log();
+            _bus.mark_screen_dirty();
+        } else {
+            bool changed = false;
             {
-                // The draw routine at the moment is not very sophisticated and will not
-                // show any clever tricks with changing attributes midway through the
-                // frame. This will need and overhaul at some point in the future but is
-                // sufficient for the time being.
-
-                // Clear screen
-                set_rendercolor(renderer, _bus.port_254 & 0x7, false);
-                SDL_RenderClear(renderer);
-
-                uint8_t *data = &_bus[0x4000];
-                uint8_t *col_data = &_bus[0x5800];
-                for (int y = 0; y < 192; y++) {
-                    int new_y = 0xc0 & y;
-                    new_y |= (y & 0x7) << 3;
-                    new_y |= (y >> 3) & 0x7;
-                    int col_y = new_y >> 3;
-                    for (int x = 0; x < 256; x += 8) {
-                        uint8_t color = col_data[col_y * 32 + (x >> 3)];
-                        bool flash = get_bit(color, 7);
-                        bool bright = get_bit(color, 6);
-                        uint8_t paper_color = (color >> 3) & 0x07;
-                        uint8_t ink_color = color & 0x07;
-
-                        // Draw paper color as 8x8 pixel block
-                        if ((new_y & 0x7) == 0 && (x & 0x7) == 0) {
-                            SDL_Rect rect = {x + 32, new_y + 32, 8, 8};
-                            set_rendercolor(renderer, ((flash & invert) ? ink_color : paper_color), bright);
-                            SDL_RenderFillRect(renderer, &rect);
-                        }
-
-                        // Draw horizontal byte in ink color
-                        set_rendercolor(renderer, ((flash & invert) ? paper_color : ink_color), bright);
-                        uint8_t pixels = *data;
-                        if (pixels != 0) {
-                            if (pixels == 255) {
-                                SDL_RenderDrawLine(renderer, x + 32, new_y + 32, x + 39, new_y + 32);
-                            } else {
-                                for (int p = 0; p < 8; p++) {
-                                    if (get_bit(*data, 7 - p)) {
-                                        SDL_RenderDrawPoint(renderer, x + p + 32, new_y + 32);
-                                    }
-                                }
-                            }
-                        }
-                        data++;
-                    }
-                }
+                HOST_PROFILE_SCOPE(host_profiler, Render);
+                Tracer::Span trace_render(tracer, "render", "video");
+                changed = render_frame();
+            }
 
-                SDL_RenderPresent(renderer);
+            HOST_PROFILE_SCOPE(host_profiler, Present);
+            Tracer::Span trace_publish(tracer, "publish", "video");
+            for (VideoSink *sink : recording_sinks) {
+                sink->frame(framebuffer.data(), changed);
             }
-#endif
-
-            frame_counter++;
-            if (frame_counter % 16 == 0) {
-                if (invert)
-                    invert = false;
-                else
-                    invert = true;
+            if (present) {
+                for (VideoSink *sink : video_sinks) {
+                    sink->frame(framebuffer.data(), changed);
+                }
             }
+        }
 
-            if (!fast_mode) {
-                uint64_t now = SDL_GetPerformanceCounter();
-                if (now < next_frame_deadline) {
-                    uint64_t remaining = next_frame_deadline - now;
-                    uint32_t ms = static_cast<uint32_t>((remaining * 1000) / perf_freq);
-                    if (ms > 0) {
-                        SDL_Delay(ms);
-                    }
-                    // Busy-wait the remainder for finer granularity
-                    while (SDL_GetPerformanceCounter() < next_frame_deadline) {
-                    }
-                }
-                next_frame_deadline += (perf_freq / 50);
+        frame_counter++;
+        if (frame_counter % 16 == 0) {
+            if (invert)
+                invert = false;
+            else
+                invert = true;
+        }
+
+        if (!fast_mode) {
+            HOST_PROFILE_SCOPE(host_profiler, Pacing);
+            pacing_clock::time_point now = pacing_clock::now();
+            if (frame_speed == 0) {
+                // Nothing to wait for, and no lateness to make up when real time resumes
+                next_frame_deadline = now + frame_period;
+            } else if (now < next_frame_deadline) {
+                Tracer::Span trace_sleep(tracer, "sleep", "pacing");
+                sleep_until(next_frame_deadline);
+                next_frame_deadline += frame_period / frame_speed;
+            } else if (now - next_frame_deadline > max_pacing_lag) {
+                // Far behind, after a break in the debugger say, so start again from now rather than racing to catch up
+                next_frame_deadline = now + frame_period / frame_speed;
+            } else {
+                next_frame_deadline += frame_period / frame_speed;
             }
+        }
+
+        HOST_PROFILE_END_FRAME(host_profiler);
+
+        if (tracer != nullptr) {
+            Tracer::clock::time_point now = Tracer::clock::now();
+            tracer->complete("frame", "emulation", frame_start, now);
+            frame_start = now;
+        }
     }
 
     counter++;
+    _bus.frame_tstate = static_cast<uint32_t>(counter);
 }
@@ -4,9 +4,18 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <vector>
 
 #include "bus.hpp"
+#include "host_profiler.hpp"
+#include "machine_io.hpp"
+#include "screen.hpp"
+#include "state.hpp"
+#include "tracer.hpp"
 #include "z80.hpp"
 
 /**
@@ -14,19 +23,99 @@
  */
 class ULA {
 public:
-    ULA(Z80 &_z80, Bus &_bus, bool fast_mode = false) : _z80(_z80), _bus(_bus), fast_mode(fast_mode) {}
+    // The host framebuffer holds the 256x192 display surrounded by a 32 pixel border
+    static constexpr int screen_width = 256;
+    static constexpr int screen_height = 192;
+    static constexpr int border_size = 32;
+    static constexpr int frame_width = screen_width + 2 * border_size;
+    static constexpr int frame_height = screen_height + 2 * border_size;
+
+    ULA(Z80 &_z80, Bus &_bus, bool fast_mode = false)
+        : _z80(_z80), _bus(_bus), fast_mode(fast_mode), framebuffer(frame_width * frame_height) {}
     virtual ~ULA() {}
 
     void clock(bool &do_exit, bool &do_break);
 
+    // Frame and line timing of the model, the bus is switched separately
+    void set_model(SpectrumModel model);
+
+    bool render_frame();
+    const uint32_t *frame() const { return framebuffer.data(); }
+    uint64_t frames_completed() const { return frame_counter; }
+    // T-states from one frame to the next, the counter runs from 0 to frame_tstates inclusive
+    uint32_t frame_length() const { return static_cast<uint32_t>(frame_tstates + 1); }
+    // CPU clock of the model, in T-states per second
+    uint32_t clock_hz() const { return cpu_clock_hz; }
+
+    void save_state(StateWriter &state) const;
+    bool load_state(StateReader &state);
+
+    /**
+     * @brief Continue from exactly where parent is, including the frame being rendered. The bus is forked separately.
+     */
+    void fork_from(const ULA &parent);
+
+    HostProfiler *host_profiler = {nullptr};
+    Tracer *tracer = {nullptr};
+
+    // Completed frames are passed to each sink, only every speed'th when running faster than real time. No frames
+    // are rendered without a sink.
+    void add_video_sink(VideoSink *sink) { video_sinks.push_back(sink); }
+    // Recording sinks are passed every completed frame whatever the speed, so a recording plays back in real time
+    void add_recording_sink(VideoSink *sink) { recording_sinks.push_back(sink); }
+
+    // Set from the thread handling host events, acted on at the start of the next frame
+    std::atomic<bool> break_requested = {false};
+    std::atomic<bool> exit_requested = {false};
+
+    // Speed as a multiple of real time, 0 for as fast as possible. Faster than real time only every speed'th frame is
+    // shown (every unlimited_frame_skip'th when unlimited). May be set from any thread, read once per frame.
+    std::atomic<uint32_t> speed = {1};
+    // Run as fast as possible while the ROM's tape loader is running
+    bool auto_warp = {false};
+    // Whether the frame just completed ran faster than real time
+    bool warping() const { return frame_speed != 1; }
+
 private:
+    using pacing_clock = std::chrono::steady_clock;
+    static constexpr std::chrono::microseconds frame_period = std::chrono::microseconds(20000);
+    static constexpr std::chrono::microseconds max_pacing_lag = std::chrono::microseconds(100000);
+    static constexpr uint32_t unlimited_frame_skip = 10;
+    // Frames auto warp carries on for after the loader was last seen, covering the gaps between blocks
+    static constexpr uint32_t warp_hold_frames = 25;
+
+    void draw_chunks(int fy, int first, int last);
+    bool tape_loader_running() const;
+
     Z80 &_z80;
     Bus &_bus;
 
+    // 48K timing by default: the first display line is fetched 14336 T-states after the interrupt
+    uint64_t frame_tstates = {69888};
+    uint32_t cpu_clock_hz = {3500000};
+    uint32_t line_tstates = {224};
+    uint32_t display_start_tstate = {14336};
+
     uint64_t counter = {0};
-    uint64_t next_frame_deadline = {0};
+    pacing_clock::time_point next_frame_deadline = {};
+    bool pacing_started = {false};
     uint64_t frame_counter = {0};
     bool invert = {false};
     bool fast_mode = {false};
-    uint64_t perf_freq = {0};
+    uint32_t frame_speed = {1};
+    uint32_t warp_frames_left = {0};
+
+    Tracer::clock::time_point frame_start = {Tracer::clock::now()};
+
+    ScreenKernel kernel = {best_screen_kernel()};
+    bool rendered_invert = {false};
+
+    // Display memory and border as of the start of the frame being rendered
+    std::array<uint8_t, 6912> shadow = {};
+    uint8_t shadow_border = {0};
+    uint32_t rows_prev = {0};
+    bool border_prev = {false};
+    std::vector<uint32_t> framebuffer;
+    std::vector<VideoSink *> video_sinks;
+    std::vector<VideoSink *> recording_sinks;
 };
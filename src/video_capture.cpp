@@ -0,0 +1,142 @@
+/**
+ * @brief Implementation of the video capture.
+ */
+
+#include "video_capture.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "common.hpp"
+
+// BT.601 studio range from 8-bit RGB, in 8.8 fixed point
+static uint8_t luma(uint32_t argb) {
+    int r = (argb >> 16) & 0xff;
+    int g = (argb >> 8) & 0xff;
+    int b = argb & 0xff;
+    return static_cast<uint8_t>(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+}
+
+static void chroma(uint32_t argb, int &u, int &v) {
+    int r = (argb >> 16) & 0xff;
+    int g = (argb >> 8) & 0xff;
+    int b = argb & 0xff;
+    u = (-38 * r - 74 * g + 112 * b + 128) >> 8;
+    v = (112 * r - 94 * g - 18 * b + 128) >> 8;
+}
+
+bool VideoCapture::open(const std::string &filename, uint32_t _skip) {
+    close();
+
+    out.open(filename, std::ios::binary);
+    if (!out) {
+        std::cerr << "Unable to write video to \'" << filename << "\'" << std::endl;
+        return false;
+    }
+
+    skip = std::max<uint32_t>(_skip, 1);
+    frame_number = 0;
+    written = 0;
+    dropped = 0;
+    planes.resize(static_cast<size_t>(width) * height * 3 / 2);
+
+    // Chroma is averaged over each 2x2 block, which is the centred siting of C420jpeg
+    out << "YUV4MPEG2 W" << width << " H" << height << " F50:" << skip << " Ip A1:1 C420jpeg\n";
+
+    stopping = false;
+    writer = std::thread(&VideoCapture::writer_loop, this);
+    return true;
+}
+
+void VideoCapture::close() {
+    if (!writer.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_ready.notify_one();
+    writer.join();
+    out.close();
+}
+
+void VideoCapture::frame(const uint32_t *pixels, bool changed) {
+    UNUSED(changed);
+    if (!writer.joinable() || frame_number++ % skip != 0) {
+        return;
+    }
+
+    size_t size = static_cast<size_t>(width) * height;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (queue.size() >= max_queued) {
+            // Never wait for the writer, show the last queued frame for longer instead
+            queue.back().repeats++;
+            dropped++;
+            return;
+        }
+
+        QueuedFrame queued = {{}, 1};
+        if (!spare.empty()) {
+            queued.pixels.swap(spare.back());
+            spare.pop_back();
+        }
+        queued.pixels.assign(pixels, pixels + size);
+        queue.push_back(std::move(queued));
+    }
+    queue_ready.notify_one();
+}
+
+void VideoCapture::writer_loop() {
+    for (;;) {
+        QueuedFrame next;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_ready.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            next = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        write_frame(next.pixels, next.repeats);
+
+        written += next.repeats;
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        spare.push_back(std::move(next.pixels));
+    }
+}
+
+void VideoCapture::write_frame(const std::vector<uint32_t> &pixels, uint32_t repeats) {
+    uint8_t *y_plane = planes.data();
+    uint8_t *u_plane = y_plane + static_cast<size_t>(width) * height;
+    uint8_t *v_plane = u_plane + static_cast<size_t>(width / 2) * (height / 2);
+
+    for (size_t i = 0; i < pixels.size(); i++) {
+        y_plane[i] = luma(pixels[i]);
+    }
+    for (int cy = 0; cy < height / 2; cy++) {
+        for (int cx = 0; cx < width / 2; cx++) {
+            int u_sum = 0;
+            int v_sum = 0;
+            for (int dy = 0; dy < 2; dy++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    int u, v;
+                    chroma(pixels[static_cast<size_t>(cy * 2 + dy) * width + cx * 2 + dx], u, v);
+                    u_sum += u;
+                    v_sum += v;
+                }
+            }
+            u_plane[cy * (width / 2) + cx] = static_cast<uint8_t>(128 + (u_sum >> 2));
+            v_plane[cy * (width / 2) + cx] = static_cast<uint8_t>(128 + (v_sum >> 2));
+        }
+    }
+
+    for (uint32_t r = 0; r < repeats; r++) {
+        out << "FRAME\n";
+        out.write(reinterpret_cast<const char *>(planes.data()), static_cast<std::streamsize>(planes.size()));
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ * @brief Header defining the video capture used to record frames as a YUV4MPEG2 stream.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "machine_io.hpp"
+
+/**
+ * @brief Writes completed frames as an uncompressed y4m stream (4:2:0, BT.601) for an external encoder, to a file
+ * or a named pipe.
+ * Frames are copied into a bounded queue and converted and written on a thread of their own. When the writer falls
+ * behind the emulation is never held up: the newest queued frame is repeated in the stream instead, so the stream
+ * keeps its timing against the audio. In fast mode only every skip'th frame need be captured.
+ */
+class VideoCapture : public VideoSink {
+public:
+    // Frames waiting for the writer, beyond this they are dropped
+    static constexpr size_t max_queued = 8;
+
+    VideoCapture(int _width, int _height) : width(_width), height(_height) {}
+    virtual ~VideoCapture() { close(); }
+
+    VideoCapture(const VideoCapture &) = delete;
+    VideoCapture &operator=(const VideoCapture &) = delete;
+
+    /**
+     * @brief Start writing to filename, keeping one frame in every skip. The stream's frame rate is 50 / skip.
+     */
+    bool open(const std::string &filename, uint32_t skip = 1);
+
+    // Write out everything queued and close the stream
+    void close();
+
+    void frame(const uint32_t *pixels, bool changed) override;
+
+    uint64_t frames_written() const { return written; }
+    uint64_t frames_dropped() const { return dropped; }
+
+private:
+    struct QueuedFrame {
+        std::vector<uint32_t> pixels;
+        uint32_t repeats;
+    };
+
+    void writer_loop();
+    void write_frame(const std::vector<uint32_t> &pixels, uint32_t repeats);
+
+    int width;
+    int height;
+    uint32_t skip = {1};
+    uint64_t frame_number = {0};
+
+    std::ofstream out;
+    std::vector<uint8_t> planes;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::deque<QueuedFrame> queue;
+    std::vector<std::vector<uint32_t>> spare;
+    bool stopping = {false};
+    std::thread writer;
+
+    std::atomic<uint64_t> written = {0};
+    std::atomic<uint64_t> dropped = {0};
+};
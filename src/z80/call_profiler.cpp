@@ -0,0 +1,133 @@
+/**
+ * @brief Implementation of the emulated call-graph profiler.
+ */
+
+#include "call_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+void CallProfiler::reset() {
+    nodes.clear();
+    nodes.emplace_back();
+    stack.clear();
+}
+
+void CallProfiler::enter(uint16_t target, uint16_t sp) {
+    // Drop any frames the new return address has overwritten
+    while (!stack.empty() && sp >= stack.back().sp) {
+        stack.pop_back();
+    }
+
+    if (stack.size() >= max_depth) {
+        return;
+    }
+
+    uint32_t parent = stack.empty() ? 0 : stack.back().node;
+    uint32_t node = 0;
+
+    auto it = nodes[parent].children.find(target);
+    if (it != nodes[parent].children.end()) {
+        node = it->second;
+    } else {
+        node = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+        nodes[node].addr = target;
+        nodes[node].parent = parent;
+        nodes[parent].children.emplace(target, node);
+    }
+
+    nodes[node].calls++;
+    stack.push_back(Frame{node, sp});
+}
+
+std::vector<uint64_t> CallProfiler::total_cycles() const {
+    // Children are always created after their parents so a reverse walk sums each subtree
+    std::vector<uint64_t> totals(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0;) {
+        totals[i] += nodes[i].self_cycles;
+        if (i != 0) {
+            totals[nodes[i].parent] += totals[i];
+        }
+    }
+    return totals;
+}
+
+void CallProfiler::write_folded(std::ostream &out, const SymbolTable &symbols) const {
+    std::vector<std::string> names(nodes.size());
+    names[0] = "[top]";
+
+    for (size_t i = 1; i < nodes.size(); i++) {
+        std::string name = symbols.describe(nodes[i].addr);
+        // Folded stacks use ';' to separate frames and a space before the count
+        std::replace(name.begin(), name.end(), ';', '_');
+        std::replace(name.begin(), name.end(), ' ', '_');
+        names[i] = names[nodes[i].parent] + ";" + name;
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].self_cycles != 0) {
+            out << names[i] << " " << nodes[i].self_cycles << "\n";
+        }
+    }
+}
+
+void CallProfiler::report(std::ostream &out, const SymbolTable &symbols, size_t max_lines) const {
+    struct Routine {
+        uint16_t addr = {0};
+        uint64_t calls = {0};
+        uint64_t inclusive = {0};
+        uint64_t exclusive = {0};
+    };
+
+    std::vector<uint64_t> totals = total_cycles();
+    std::map<uint16_t, Routine> routines;
+
+    for (size_t i = 1; i < nodes.size(); i++) {
+        const Node &node = nodes[i];
+        Routine &r = routines[node.addr];
+        r.addr = node.addr;
+        r.calls += node.calls;
+        r.exclusive += node.self_cycles;
+
+        // Recursive calls are already included in the inclusive time of the outermost call
+        bool recursive = false;
+        for (uint32_t p = node.parent; p != 0 && !recursive; p = nodes[p].parent) {
+            recursive = (nodes[p].addr == node.addr);
+        }
+        if (!recursive) {
+            r.inclusive += totals[i];
+        }
+    }
+
+    std::vector<Routine> sorted;
+    for (const auto &[addr, r] : routines) {
+        sorted.push_back(r);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Routine &a, const Routine &b) { return a.inclusive > b.inclusive; });
+
+    out << "Total T-states: " << totals[0] << " (outside any call: " << nodes[0].self_cycles << ")\n";
+    out << std::left << std::setw(28) << "routine" << std::right << std::setw(12) << "calls" << std::setw(16)
+        << "inclusive" << std::setw(16) << "exclusive" << "\n";
+    for (size_t i = 0; i < sorted.size() && (max_lines == 0 || i < max_lines); i++) {
+        const Routine &r = sorted[i];
+        out << std::left << std::setw(28) << symbols.describe(r.addr) << std::right << std::setw(12) << r.calls
+            << std::setw(16) << r.inclusive << std::setw(16) << r.exclusive << "\n";
+    }
+}
+
+bool CallProfiler::dump(const std::string &filename, const SymbolTable &symbols) const {
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Unable to write call profile to \'" << filename << "\'" << std::endl;
+        return false;
+    }
+
+    write_folded(out, symbols);
+
+    std::cout << "Call profile (folded stacks) written to " << filename << std::endl;
+    return true;
+}
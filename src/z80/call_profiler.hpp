@@ -0,0 +1,71 @@
+/**
+ * @brief Header defining the emulated call-graph profiler.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "symbols.hpp"
+
+/**
+ * @brief Keeps a shadow call stack of the emulated code and attributes T-states to each call path.
+ * Frames are unwound by comparing the stack pointer with the address each return address was pushed to rather than
+ * by matching RET instructions. This keeps the shadow stack correct when code pops its return address, reloads SP or
+ * uses RET as a jump.
+ */
+class CallProfiler {
+public:
+    CallProfiler() { reset(); }
+    virtual ~CallProfiler() {}
+
+    /**
+     * @brief Attribute cycles to the current frame.
+     * @param sp the stack pointer before the instruction executed
+     */
+    void sample(uint16_t sp, uint32_t cycles) {
+        while (!stack.empty() && sp > stack.back().sp) {
+            stack.pop_back();
+        }
+        nodes[stack.empty() ? 0 : stack.back().node].self_cycles += cycles;
+    }
+
+    void enter(uint16_t target, uint16_t sp);
+
+    void reset();
+
+    size_t depth() const { return stack.size(); }
+
+    void write_folded(std::ostream &out, const SymbolTable &symbols) const;
+    void report(std::ostream &out, const SymbolTable &symbols, size_t max_lines = 20) const;
+    bool dump(const std::string &filename, const SymbolTable &symbols) const;
+
+    // Allows profiling to be paused and resumed without detaching the profiler from the Z80
+    bool enabled = {true};
+
+private:
+    // Deeper call chains are still attributed to the deepest tracked frame
+    static constexpr size_t max_depth = 512;
+
+    struct Node {
+        uint16_t addr = {0};
+        uint32_t parent = {0};
+        uint64_t self_cycles = {0};
+        uint64_t calls = {0};
+        std::map<uint16_t, uint32_t> children;
+    };
+
+    struct Frame {
+        uint32_t node = {0};
+        uint16_t sp = {0};  // Where the return address of this frame lives on the stack
+    };
+
+    std::vector<uint64_t> total_cycles() const;
+
+    std::vector<Node> nodes;  // Call tree where node 0 is the code running outside of any tracked call
+    std::vector<Frame> stack;
+};
@@ -5,13 +5,10 @@
 
 #include "common.hpp"
 
-static std::map<uint32_t, Instruction> map_inst;
-static std::map<uint32_t, std::string> map_rom;
+static const Instruction inv_inst{InstType::INV, "INVALID", 0, 0};
+static const std::string unk_rom_addr{""};
 
-static Instruction inv_inst{InstType::INV, "INVALID", 0, 0};
-static std::string unk_rom_addr{""};
-
-void init_map_inst() {
+static void init_map_inst(std::map<uint32_t, Instruction> &map_inst) {
     map_inst.emplace(0x00, Instruction{InstType::NOP, "nop", 1, 4});
     map_inst.emplace(0x01, Instruction{InstType::LD, "ld bc,**", 3, 10, Operand::BC, Operand::NN});
     map_inst.emplace(0x02, Instruction{InstType::LD, "ld (bc),a", 1, 7, Operand::indBC, Operand::A});
@@ -968,7 +965,7 @@ void init_map_inst() {
     map_inst.emplace(0xfdcbfe, Instruction{InstType::SET, "set 7,(iy+*)", 4, 23, Operand::indIYN, Operand::SEVEN});
 }
 
-void init_map_rom() {
+static void init_map_rom(std::map<uint32_t, std::string> &map_rom) {
     map_rom.emplace(0x0000, "START");
     map_rom.emplace(0x0008, "ERROR-1");
     map_rom.emplace(0x0010, "PRINT-A-1");
@@ -2039,49 +2036,70 @@ void init_map_rom() {
     map_rom.emplace(0x386c, "LAST");
 }
 
-const Instruction& decode_opcode(uint32_t opcode) {
-    if (map_inst.empty()) {
-        init_map_inst();
+/**
+ * @brief Decode tables, built once on first use and never modified so any number of machines on any number of
+ * threads can share them.
+ */
+struct InstructionTables {
+    InstructionTables() {
+        init_map_inst(map_inst);
+
+        // For unused IX/IY prefixes, the prefix is ignored but still consumes a byte.
+        for (const auto &[opcode, inst] : map_inst) {
+            if (opcode <= 0xff) {
+                Instruction prefixed = inst;
+                prefixed.size = inst.size + 1;
+                map_prefixed.emplace(opcode, prefixed);
+            }
+        }
     }
 
-    auto search_op = map_inst.find(opcode);
-    if (search_op != map_inst.end()) {
+    std::map<uint32_t, Instruction> map_inst;
+    std::map<uint32_t, Instruction> map_prefixed;  // Keyed by the opcode following the ignored prefix
+};
+
+static const InstructionTables &instruction_tables() {
+    static const InstructionTables tables;
+    return tables;
+}
+
+static const std::map<uint32_t, std::string> &rom_labels() {
+    static const std::map<uint32_t, std::string> map_rom = []() {
+        std::map<uint32_t, std::string> labels;
+        init_map_rom(labels);
+        return labels;
+    }();
+    return map_rom;
+}
+
+const Instruction& decode_opcode(uint32_t opcode) {
+    const InstructionTables &tables = instruction_tables();
+
+    auto search_op = tables.map_inst.find(opcode);
+    if (search_op != tables.map_inst.end()) {
         return search_op->second;
     }
 
     uint32_t prefix = opcode & 0xff00;
     if (prefix == 0xdd00 || prefix == 0xfd00) {
-        uint32_t base_op = opcode & 0xff;
-        auto base_it = map_inst.find(base_op);
-        if (base_it != map_inst.end()) {
-            // For unused IX/IY prefixes, the prefix is ignored but still consumes a byte.
-            static thread_local Instruction prefixed_copy = base_it->second;
-            prefixed_copy = base_it->second;
-            prefixed_copy.size = base_it->second.size + 1;
-            return prefixed_copy;
+        auto prefixed_it = tables.map_prefixed.find(opcode & 0xff);
+        if (prefixed_it != tables.map_prefixed.end()) {
+            return prefixed_it->second;
         }
     }
 
     return inv_inst;
 }
 
-bool has_rom_label(uint32_t address) {
-    if (map_rom.empty()) {
-        init_map_rom();
-    }
-
-    return map_rom.find(address) != map_rom.end();
-}
+bool has_rom_label(uint32_t address) { return rom_labels().find(address) != rom_labels().end(); }
 
 const std::string& decode_rom_label(uint32_t address) {
-    if (map_rom.empty()) {
-        init_map_rom();
-    }
-
-    auto search_rom = map_rom.find(address);
-    if (search_rom != map_rom.end()) {
+    auto search_rom = rom_labels().find(address);
+    if (search_rom != rom_labels().end()) {
         return search_rom->second;
     }
 
     return unk_rom_addr;
 }
+
+const std::map<uint32_t, std::string>& get_rom_labels() { return rom_labels(); }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <string>
 
 #include "instructions.hpp"
@@ -12,3 +13,4 @@
 const Instruction& decode_opcode(uint32_t opcode);
 bool has_rom_label(uint32_t address);
 const std::string& decode_rom_label(uint32_t address);
+const std::map<uint32_t, std::string>& get_rom_labels();
@@ -0,0 +1,106 @@
+/**
+ * @brief Implementation of the program counter hotspot profiler.
+ */
+
+#include "hotspot_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+void HotspotProfiler::reset() { std::fill(entries.begin(), entries.end(), Entry{}); }
+
+void HotspotProfiler::report(std::ostream &out, const SymbolTable &symbols, size_t max_lines) const {
+    struct Routine {
+        uint16_t base = {0};
+        std::string name;
+        uint64_t count = {0};
+        uint64_t cycles = {0};
+    };
+
+    std::map<uint32_t, Routine> routines;
+    std::vector<uint16_t> addrs;
+    uint64_t total_cycles = 0;
+
+    for (uint32_t addr = 0; addr < entries.size(); addr++) {
+        const Entry &e = entries[addr];
+        if (e.count == 0) {
+            continue;
+        }
+
+        uint16_t base = 0;
+        std::string name;
+        if (!symbols.find_routine(addr, base, name)) {
+            // Without a symbol, fold unknown code into 256 byte blocks
+            std::stringstream str;
+            base = addr & 0xff00;
+            str << "<0x" << std::hex << std::setw(4) << std::setfill('0') << base << "-0x" << std::setw(4)
+                << (base | 0xff) << ">";
+            name = str.str();
+        }
+
+        // Key on both the base and whether it was a symbol so a symbol can't merge with a block
+        Routine &r = routines[(base << 1) | (name[0] == '<' ? 1 : 0)];
+        r.base = base;
+        r.name = name;
+        r.count += e.count;
+        r.cycles += e.cycles;
+
+        addrs.push_back(static_cast<uint16_t>(addr));
+        total_cycles += e.cycles;
+    }
+
+    std::vector<Routine> sorted;
+    for (const auto &[key, r] : routines) {
+        sorted.push_back(r);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Routine &a, const Routine &b) { return a.cycles > b.cycles; });
+    std::sort(addrs.begin(), addrs.end(),
+              [this](uint16_t a, uint16_t b) { return entries[a].cycles > entries[b].cycles; });
+
+    auto percent = [total_cycles](uint64_t cycles) {
+        return total_cycles ? (100.0 * static_cast<double>(cycles) / static_cast<double>(total_cycles)) : 0.0;
+    };
+
+    out << "Total T-states: " << total_cycles << "\n\n";
+
+    out << "Routines by T-states\n";
+    out << std::left << std::setw(28) << "routine" << std::setw(8) << "addr" << std::right << std::setw(16)
+        << "executions" << std::setw(16) << "tstates" << std::setw(9) << "%" << "\n";
+    for (size_t i = 0; i < sorted.size() && (max_lines == 0 || i < max_lines); i++) {
+        const Routine &r = sorted[i];
+        std::stringstream addr;
+        addr << "0x" << std::hex << std::setw(4) << std::setfill('0') << r.base;
+        out << std::left << std::setw(28) << r.name << std::setw(8) << addr.str() << std::right << std::setw(16)
+            << r.count << std::setw(16) << r.cycles << std::setw(8) << std::fixed << std::setprecision(2)
+            << percent(r.cycles) << "%\n";
+    }
+
+    out << "\nAddresses by T-states\n";
+    out << std::left << std::setw(8) << "addr" << std::setw(28) << "location" << std::right << std::setw(16)
+        << "executions" << std::setw(16) << "tstates" << std::setw(9) << "%" << "\n";
+    for (size_t i = 0; i < addrs.size() && (max_lines == 0 || i < max_lines); i++) {
+        const Entry &e = entries[addrs[i]];
+        std::stringstream addr;
+        addr << "0x" << std::hex << std::setw(4) << std::setfill('0') << addrs[i];
+        out << std::left << std::setw(8) << addr.str() << std::setw(28) << symbols.describe(addrs[i]) << std::right
+            << std::setw(16) << e.count << std::setw(16) << e.cycles << std::setw(8) << std::fixed
+            << std::setprecision(2) << percent(e.cycles) << "%\n";
+    }
+}
+
+bool HotspotProfiler::dump(const std::string &filename, const SymbolTable &symbols) const {
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Unable to write hotspot profile to \'" << filename << "\'" << std::endl;
+        return false;
+    }
+
+    report(out, symbols, 0);
+
+    std::cout << "Hotspot profile written to " << filename << std::endl;
+    return true;
+}
@@ -0,0 +1,46 @@
+/**
+ * @brief Header defining the program counter hotspot profiler.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "symbols.hpp"
+
+/**
+ * @brief Counts executions and T-states for every address in the 64K address space.
+ * The report folds addresses into routines using a symbol table to show where emulated time is spent.
+ */
+class HotspotProfiler {
+public:
+    struct Entry {
+        uint64_t count = {0};
+        uint64_t cycles = {0};
+    };
+
+    HotspotProfiler() : entries(65536) {}
+    virtual ~HotspotProfiler() {}
+
+    void record(uint16_t addr, uint32_t cycles) {
+        Entry &entry = entries[addr];
+        entry.count++;
+        entry.cycles += cycles;
+    }
+
+    const Entry &entry(uint16_t addr) const { return entries[addr]; }
+
+    void reset();
+
+    void report(std::ostream &out, const SymbolTable &symbols, size_t max_lines = 50) const;
+    bool dump(const std::string &filename, const SymbolTable &symbols) const;
+
+    // Allows profiling to be paused and resumed without detaching the profiler from the Z80
+    bool enabled = {true};
+
+private:
+    std::vector<Entry> entries;
+};
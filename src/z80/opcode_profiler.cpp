@@ -0,0 +1,135 @@
+/**
+ * @brief Implementation of the per-opcode execution profiler.
+ */
+
+#include "opcode_profiler.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "decoder.hpp"
+
+void OpcodeProfiler::reset() { entries = {}; }
+
+OpcodeProfiler::Table OpcodeProfiler::table_of(uint32_t opcode) {
+    switch (opcode >> 8) {
+        case 0xcb:
+            return Table::CB;
+        case 0xed:
+            return Table::ED;
+        case 0xdd:
+            return Table::DD;
+        case 0xfd:
+            return Table::FD;
+        case 0xddcb:
+            return Table::DDCB;
+        case 0xfdcb:
+            return Table::FDCB;
+        default:
+            return Table::Main;
+    }
+}
+
+const char *OpcodeProfiler::table_name(Table table) {
+    switch (table) {
+        case Table::CB:
+            return "cb";
+        case Table::ED:
+            return "ed";
+        case Table::DD:
+            return "dd";
+        case Table::FD:
+            return "fd";
+        case Table::DDCB:
+            return "ddcb";
+        case Table::FDCB:
+            return "fdcb";
+        case Table::Main:
+        default:
+            return "main";
+    }
+}
+
+uint32_t OpcodeProfiler::opcode_of(Table table, uint32_t index) {
+    switch (table) {
+        case Table::CB:
+            return 0xcb00 | index;
+        case Table::ED:
+            return 0xed00 | index;
+        case Table::DD:
+            return 0xdd00 | index;
+        case Table::FD:
+            return 0xfd00 | index;
+        case Table::DDCB:
+            return 0xddcb00 | index;
+        case Table::FDCB:
+            return 0xfdcb00 | index;
+        case Table::Main:
+        default:
+            return index;
+    }
+}
+
+void OpcodeProfiler::dump_csv(std::ostream &out) const {
+    out << "table,opcode,mnemonic,count,tstates\n";
+
+    for (size_t t = 0; t < num_tables; t++) {
+        Table table = static_cast<Table>(t);
+        for (uint32_t i = 0; i < 256; i++) {
+            const Entry &e = entries[t][i];
+            if (e.count == 0) {
+                continue;
+            }
+
+            uint32_t opcode = opcode_of(table, i);
+            out << table_name(table) << ",0x" << std::hex << opcode << std::dec << ",\""
+                << decode_opcode(opcode).name << "\"," << e.count << "," << e.cycles << "\n";
+        }
+    }
+}
+
+void OpcodeProfiler::dump_json(std::ostream &out) const {
+    out << "[\n";
+
+    bool first = true;
+    for (size_t t = 0; t < num_tables; t++) {
+        Table table = static_cast<Table>(t);
+        for (uint32_t i = 0; i < 256; i++) {
+            const Entry &e = entries[t][i];
+            if (e.count == 0) {
+                continue;
+            }
+
+            uint32_t opcode = opcode_of(table, i);
+            if (!first) {
+                out << ",\n";
+            }
+            first = false;
+
+            out << "  {\"table\": \"" << table_name(table) << "\", \"opcode\": \"0x" << std::hex << opcode << std::dec
+                << "\", \"mnemonic\": \"" << decode_opcode(opcode).name << "\", \"count\": " << e.count
+                << ", \"tstates\": " << e.cycles << "}";
+        }
+    }
+
+    out << "\n]\n";
+}
+
+bool OpcodeProfiler::dump(const std::string &filename) const {
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Unable to write opcode profile to \'" << filename << "\'" << std::endl;
+        return false;
+    }
+
+    // Pick the output format from the file extension, defaulting to CSV
+    if (filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0) {
+        dump_json(out);
+    } else {
+        dump_csv(out);
+    }
+
+    std::cout << "Opcode profile written to " << filename << std::endl;
+    return true;
+}
@@ -0,0 +1,49 @@
+/**
+ * @brief Header defining the per-opcode execution profiler.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Counts executions and T-states of every decoded opcode, split by prefix table.
+ */
+class OpcodeProfiler {
+public:
+    enum class Table { Main, CB, ED, DD, FD, DDCB, FDCB };
+    static constexpr size_t num_tables = 7;
+
+    struct Entry {
+        uint64_t count = {0};
+        uint64_t cycles = {0};
+    };
+
+    void record(uint32_t opcode, uint32_t cycles) {
+        Entry &entry = entries[static_cast<size_t>(table_of(opcode))][opcode & 0xff];
+        entry.count++;
+        entry.cycles += cycles;
+    }
+
+    const Entry &entry(uint32_t opcode) const { return entries[static_cast<size_t>(table_of(opcode))][opcode & 0xff]; }
+
+    void reset();
+
+    void dump_csv(std::ostream &out) const;
+    void dump_json(std::ostream &out) const;
+    bool dump(const std::string &filename) const;
+
+    static Table table_of(uint32_t opcode);
+    static const char *table_name(Table table);
+
+    // Allows profiling to be paused and resumed without detaching the profiler from the Z80
+    bool enabled = {true};
+
+private:
+    static uint32_t opcode_of(Table table, uint32_t index);
+
+    std::array<std::array<Entry, 256>, num_tables> entries = {};
+};
@@ -26,6 +26,8 @@ public:
     void set(uint16_t v) { reg = v; }
     uint16_t get() const { return reg; }
     void swap() { std::swap(reg, alt_reg); }
+    void set_alt(uint16_t v) { alt_reg = v; }
+    uint16_t get_alt() const { return alt_reg; }
 
     StorageElement element() { return StorageElement(&c_reg[0], 2); }
     StorageElement element_hi() { return StorageElement(&c_reg[WORD_HI_BYTE_IDX], 1); }
@@ -113,31 +113,31 @@ StorageElement StorageElement::create_element(Z80 &state, Operand operand) {
         case Operand::IYL:
             return state.iy.element_lo();
         case Operand::indBC:
-            return StorageElement(&state.bus[state.bc.get()], 1);
+            return state.bus.access_element(state.bc.get(), 1);
         case Operand::indDE:
-            return StorageElement(&state.bus[state.de.get()], 1);
+            return state.bus.access_element(state.de.get(), 1);
         case Operand::indHL:
-            return StorageElement(&state.bus[state.hl.get()], 1);
+            return state.bus.access_element(state.hl.get(), 1);
         case Operand::indN: {
-            return StorageElement(&state.bus[state.bus.read_addr_from_mem(state.curr_operand_pc)], 1);
+            return state.bus.access_element(state.bus.read_addr_from_mem(state.curr_operand_pc), 1);
         }
         case Operand::indNN: {
-            return StorageElement(&state.bus[state.bus.read_addr_from_mem(state.curr_operand_pc)], 2);
+            return state.bus.access_element(state.bus.read_addr_from_mem(state.curr_operand_pc), 2);
         }
         case Operand::indIXN: {
             int offset = static_cast<int8_t>(state.bus.read_data(state.curr_operand_pc));
-            uint8_t *ptr = &state.bus[state.ix.get() + offset];
+            uint16_t addr = state.ix.get() + offset;
             state.curr_operand_pc += 1;
-            return StorageElement(ptr, 1);
+            return state.bus.access_element(addr, 1);
         }
         case Operand::indIYN: {
             int offset = static_cast<int8_t>(state.bus.read_data(state.curr_operand_pc));
-            uint8_t *ptr = &state.bus[state.iy.get() + offset];
+            uint16_t addr = state.iy.get() + offset;
             state.curr_operand_pc += 1;
-            return StorageElement(ptr, 1);
+            return state.bus.access_element(addr, 1);
         }
         case Operand::indSP:
-            return StorageElement(&state.bus[state.sp.get()], 2);
+            return state.bus.access_element(state.sp.get(), 2);
         case Operand::ZERO:
             return StorageElement(0x00);
         case Operand::ONE:
@@ -182,6 +182,7 @@ StorageElement &StorageElement::operator=(const StorageElement &rhs) {
     assert(count == rhs.count);
     if ((this != &rhs) && (!readonly)) {
         std::memcpy(ptr, rhs.ptr, count);
+        mark_written();
         flag_carry = rhs.flag_carry;
         flag_half_carry = rhs.flag_half_carry;
         flag_overflow = rhs.flag_overflow;
@@ -193,6 +194,7 @@ StorageElement &StorageElement::operator=(const uint8_t rhs) {
     assert(count == 1);
     if (!readonly) {
         ptr[0] = rhs;
+        mark_written();
     }
     return *this;
 }
@@ -267,6 +269,8 @@ void StorageElement::swap(StorageElement &rhs) {
 
     rhs.ptr[WORD_LO_BYTE_IDX] = tmp_lo;
     rhs.ptr[WORD_HI_BYTE_IDX] = tmp_hi;
+    mark_written();
+    rhs.mark_written();
 }
 
 bool StorageElement::get_bit(StorageElement &rhs) {
@@ -296,6 +300,7 @@ uint16_t StorageElement::push(Bus &bus, uint16_t addr) {
 uint16_t StorageElement::pop(Bus &bus, uint16_t addr) {
     ptr[WORD_LO_BYTE_IDX] = bus.read_data(addr);
     ptr[WORD_HI_BYTE_IDX] = bus.read_data(addr + 1);
+    mark_written();
     return addr + 2;
 }
 
@@ -448,6 +453,7 @@ int StorageElement::to_s32() const {
 }
 
 void StorageElement::from_u32(uint32_t v) {
+    mark_written();
     switch (count) {
         case 1:
             *static_cast<uint8_t *>(ptr) = static_cast<uint8_t>(v);
@@ -52,6 +52,9 @@ public:
     void shift_left(bool logical);
     void invert();
 
+    // flag is set whenever a value is stored through this element or a copy of it
+    void track_writes(bool *flag) { written = flag; }
+
     /**
      * Query functions.
      */
@@ -86,8 +89,15 @@ private:
     void update_borrow(const StorageElement &op1, const StorageElement &op2, bool is_half = false);
     void update_overflow(const StorageElement &op1, const StorageElement &op2, bool is_sub = false);
 
+    void mark_written() {
+        if (written != nullptr) {
+            *written = true;
+        }
+    }
+
     uint8_t *ptr = {nullptr};
     size_t count = {0};
+    bool *written = {nullptr};
 
     bool flag_carry = false;
     bool flag_half_carry = false;
@@ -0,0 +1,161 @@
+/**
+ * @brief Implementation of the symbol table.
+ */
+
+#include "symbols.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "decoder.hpp"
+
+// ROM labels only describe the ROM so never let them absorb addresses above it
+constexpr uint16_t rom_end = 0x4000;
+
+SymbolTable::SymbolTable(bool use_rom_labels) {
+    if (use_rom_labels) {
+        for (const auto &[addr, name] : get_rom_labels()) {
+            symbols.emplace(static_cast<uint16_t>(addr), name);
+        }
+    }
+}
+
+/**
+ * @brief Load a user symbol file.
+ * Each line holds either "<addr> <name>" or "<name> = <addr>" / "<name> equ <addr>" as output by most Z80
+ * assemblers, or "<name> <addr>". Addresses are hexadecimal and may be written as 8000, 0x8000, $8000, #8000 or
+ * 8000h. When both of two tokens could be an address, the first is taken as the address unless only the second starts
+ * with a digit, $ or #. Lines starting with ';' or '#' followed by a space are ignored.
+ */
+bool SymbolTable::load(const std::string &filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "No symbol file found called \'" << filename << "\'" << std::endl;
+        return false;
+    }
+
+    std::string line;
+    size_t line_no = 0;
+    size_t loaded = 0;
+    while (std::getline(file, line)) {
+        line_no++;
+
+        std::vector<std::string> tokens;
+        std::stringstream str(line);
+        std::string token;
+        while (str >> token) {
+            tokens.push_back(token);
+        }
+
+        if (tokens.empty() || tokens[0][0] == ';' || (tokens[0] == "#")) {
+            continue;
+        }
+
+        // Names such as "fade" or "add" look like addresses, so the assignment forms are recognised by their
+        // operator before trying to tell which of two tokens is the address
+        uint16_t addr = 0;
+        std::string name;
+        bool ok = false;
+        if (tokens.size() >= 3 && is_assignment(tokens[1])) {
+            ok = parse_addr(tokens[2], addr);
+            name = tokens[0];
+        } else if (tokens.size() == 2 && is_number(tokens[1]) && !is_number(tokens[0])) {
+            ok = parse_addr(tokens[1], addr);
+            name = tokens[0];
+        } else if (tokens.size() >= 2 && parse_addr(tokens[0], addr)) {
+            ok = true;
+            name = tokens[1];
+        } else if (tokens.size() == 2) {
+            ok = parse_addr(tokens[1], addr);
+            name = tokens[0];
+        }
+        if (!ok) {
+            std::cerr << filename << ":" << line_no << ": ignoring unrecognised symbol line" << std::endl;
+            continue;
+        }
+
+        if (name.back() == ':') {
+            name.pop_back();
+        }
+        add(addr, name);
+        loaded++;
+    }
+
+    std::cout << "Loaded " << loaded << " symbols from " << filename << std::endl;
+    return true;
+}
+
+bool SymbolTable::is_assignment(const std::string &str) {
+    std::string lower;
+    for (char ch : str) {
+        lower += static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    }
+    return lower == "=" || lower == "equ";
+}
+
+// Assemblers require numbers to start with a digit, so only a token starting with one or with $ or # must be an address
+bool SymbolTable::is_number(const std::string &str) {
+    return !str.empty() && (std::isdigit(static_cast<unsigned char>(str[0])) || str[0] == '$' || str[0] == '#');
+}
+
+bool SymbolTable::parse_addr(std::string str, uint16_t &addr) {
+    if (str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        str = str.substr(2);
+    } else if (str.size() > 1 && (str[0] == '$' || str[0] == '#')) {
+        str = str.substr(1);
+    } else if (str.size() > 1 && (str.back() == 'h' || str.back() == 'H')) {
+        str.pop_back();
+    }
+
+    if (str.empty() || str.size() > 4) {
+        return false;
+    }
+    for (char ch : str) {
+        if (!std::isxdigit(static_cast<unsigned char>(ch))) {
+            return false;
+        }
+    }
+
+    addr = static_cast<uint16_t>(std::stoul(str, nullptr, 16));
+    return true;
+}
+
+/**
+ * @brief Find the routine an address belongs to, i.e. the nearest symbol at or below it.
+ */
+bool SymbolTable::find_routine(uint16_t addr, uint16_t &base, std::string &name) const {
+    auto it = symbols.upper_bound(addr);
+    if (it == symbols.begin()) {
+        return false;
+    }
+    --it;
+
+    if (addr >= rom_end && it->first < rom_end) {
+        return false;
+    }
+
+    base = it->first;
+    name = it->second;
+    return true;
+}
+
+std::string SymbolTable::describe(uint16_t addr) const {
+    std::stringstream str;
+
+    uint16_t base = 0;
+    std::string name;
+    if (find_routine(addr, base, name)) {
+        str << name;
+        if (addr != base) {
+            str << "+" << (addr - base);
+        }
+    } else {
+        str << "0x" << std::hex << std::setw(4) << std::setfill('0') << addr;
+    }
+
+    return str.str();
+}
@@ -0,0 +1,34 @@
+/**
+ * @brief Header defining the symbol table used to name emulated code addresses.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+/**
+ * @brief Maps addresses to routine names using the ROM labels and optional user symbol files.
+ */
+class SymbolTable {
+public:
+    explicit SymbolTable(bool use_rom_labels = true);
+    virtual ~SymbolTable() {}
+
+    bool load(const std::string &filename);
+    void add(uint16_t addr, const std::string &name) { symbols[addr] = name; }
+
+    bool has_symbol(uint16_t addr) const { return symbols.find(addr) != symbols.end(); }
+    bool find_routine(uint16_t addr, uint16_t &base, std::string &name) const;
+    std::string describe(uint16_t addr) const;
+
+    size_t size() const { return symbols.size(); }
+
+private:
+    static bool is_assignment(const std::string &str);
+    static bool is_number(const std::string &str);
+    static bool parse_addr(std::string str, uint16_t &addr);
+
+    std::map<uint16_t, std::string> symbols;
+};
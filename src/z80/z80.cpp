@@ -21,6 +21,9 @@ bool Z80::clock(bool no_cycles) {
     // executed. This gives the emulation roughly the right behaviour for each instruction.
     if (cycles_left == 0) {
         uint32_t cycles = 0;
+        uint16_t inst_pc = 0;  // Address the cycles are attributed to when profiling
+        uint16_t inst_sp = sp.get();
+        bool is_call = false;  // Set when a return address was pushed and control moved to a routine
         if (int_nmi) {
             Instruction inst{InstType::PUSH, "NMI", 1, 11, Operand::UNUSED, Operand::PC};
             update_r_reg(inst);
@@ -31,6 +34,8 @@ bool Z80::clock(bool no_cycles) {
             int_nmi = false;
             ei_pending = false;
             halted = false;
+            inst_pc = pc.get();
+            is_call = true;
             found = true;
         } else if (iff1 && interrupt) {
             halted = false;
@@ -45,6 +50,8 @@ bool Z80::clock(bool no_cycles) {
                     pc.set(0x38);
                     interrupt = false;
                     ei_pending = false;
+                    inst_pc = pc.get();
+                    is_call = true;
                     found = true;
                     break;
                 }
@@ -58,6 +65,8 @@ bool Z80::clock(bool no_cycles) {
                     pc.set(jump_addr);
                     interrupt = false;
                     ei_pending = false;
+                    inst_pc = pc.get();
+                    is_call = true;
                     found = true;
                     break;
                 }
@@ -68,6 +77,7 @@ bool Z80::clock(bool no_cycles) {
             Instruction inst{InstType::NOP, "halt", 1, 4};
             update_r_reg(inst);
             cycles = const_cast<Instruction &>(inst).execute(*this);
+            inst_pc = curr_opcode_pc;
             found = true;
         } else {
             curr_opcode_pc = pc.get();
@@ -82,17 +92,34 @@ bool Z80::clock(bool no_cycles) {
             if (inst.inst != InstType::INV) {
                 pc.set(curr_opcode_pc + inst.size);
                 cycles = const_cast<Instruction &>(inst).execute(*this);
+                if (opcode_profiler != nullptr && opcode_profiler->enabled) {
+                    opcode_profiler->record(opcode, cycles);
+                }
                 if (ei_pending && inst.inst != InstType::EI) {
                     iff1 = true;
                     iff2 = true;
                     ei_pending = false;
                 }
+                inst_pc = curr_opcode_pc;
+                // Conditional calls only push when taken
+                is_call = (inst.inst == InstType::CALL || inst.inst == InstType::RST) && sp.get() != inst_sp;
                 found = true;
             } else {
                 std::cerr << "UNKNOWN OPCODE: 0x" << std::hex << std::setw(8) << std::setfill('0') << opcode;
                 std::cerr << " at 0x" << curr_opcode_pc << std::endl;
             }
         }
+        // Memory operands that could not be referenced directly are written back now
+        bus.flush_deferred();
+        if (hotspot_profiler != nullptr && hotspot_profiler->enabled && found) {
+            hotspot_profiler->record(inst_pc, cycles);
+        }
+        if (call_profiler != nullptr && call_profiler->enabled && found) {
+            call_profiler->sample(inst_sp, cycles);
+            if (is_call) {
+                call_profiler->enter(pc.get(), sp.get());
+            }
+        }
         cycles_left = cycles;
         total_cycles += cycles;
     } else {
@@ -119,6 +146,57 @@ void Z80::reset() {
     ei_pending = false;
 }
 
+void Z80::save_state(StateWriter &state) const {
+    for (const Register16 *reg : {&pc, &sp, &ix, &iy, &ir}) {
+        state.put(reg->get());
+    }
+    for (const Register16 *reg : {static_cast<const Register16 *>(&af), &hl, &bc, &de}) {
+        state.put(reg->get());
+        state.put(reg->get_alt());
+    }
+
+    state.put(curr_opcode_pc);
+    state.put(curr_operand_pc);
+    state.put(top_of_stack);
+    state.put(iff1);
+    state.put(iff2);
+    state.put(int_mode);
+    state.put(int_nmi);
+    state.put(interrupt);
+    state.put(halted);
+    state.put(ei_pending);
+    state.put(cycles_left);
+    state.put(total_cycles);
+}
+
+bool Z80::load_state(StateReader &state) {
+    uint16_t value = 0;
+    for (Register16 *reg : {&pc, &sp, &ix, &iy, &ir}) {
+        state.get(value);
+        reg->set(value);
+    }
+    for (Register16 *reg : {static_cast<Register16 *>(&af), &hl, &bc, &de}) {
+        state.get(value);
+        reg->set(value);
+        state.get(value);
+        reg->set_alt(value);
+    }
+
+    state.get(curr_opcode_pc);
+    state.get(curr_operand_pc);
+    state.get(top_of_stack);
+    state.get(iff1);
+    state.get(iff2);
+    state.get(int_mode);
+    state.get(int_nmi);
+    state.get(interrupt);
+    state.get(halted);
+    state.get(ei_pending);
+    state.get(cycles_left);
+    state.get(total_cycles);
+    return state.ok();
+}
+
 void Z80::update_r_reg(const Instruction &inst, uint32_t opcode) {
     (void)inst;
     uint8_t r = ir.lo();
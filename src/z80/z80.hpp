@@ -7,8 +7,12 @@
 #include <cstdint>
 
 #include "bus.hpp"
+#include "call_profiler.hpp"
+#include "hotspot_profiler.hpp"
 #include "instructions.hpp"
+#include "opcode_profiler.hpp"
 #include "register.hpp"
+#include "state.hpp"
 
 /**
  * @brief Class describing a Z80 state.
@@ -47,10 +51,18 @@ public:
 
     Register16 ir;
 
+    // Optional profilers (nullptr when profiling is off)
+    OpcodeProfiler *opcode_profiler = {nullptr};    // Records every decoded opcode
+    HotspotProfiler *hotspot_profiler = {nullptr};  // Records the address time was spent at
+    CallProfiler *call_profiler = {nullptr};        // Records time spent in each emulated call path
+
     bool clock(bool no_cycles = false);
 
     void reset();
 
+    void save_state(StateWriter &state) const;
+    bool load_state(StateReader &state);
+
     void update_r_reg(const Instruction &inst, uint32_t opcode = 0x00);
 
 private:
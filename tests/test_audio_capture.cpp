@@ -0,0 +1,71 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "audio_capture.hpp"
+
+namespace {
+class HeardSink : public AudioSink {
+public:
+    void write(const int16_t *samples, size_t count) override {
+        (void)samples;
+        heard += count;
+    }
+    size_t heard = {0};
+};
+}  // namespace
+
+TEST_CASE("Audio capture writes WAV and raw files", "[audio_capture]") {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "jrnz_test_audio_capture";
+    std::filesystem::create_directories(dir);
+
+    std::vector<int16_t> block(500);
+    for (size_t i = 0; i < block.size(); i++) {
+        block[i] = static_cast<int16_t>(i * 37 - 9000);
+    }
+
+    for (const char *name : {"out.wav", "out.pcm"}) {
+        std::string filename = (dir / name).string();
+        AudioCapture capture;
+        HeardSink speaker;
+        capture.forward = &speaker;
+        REQUIRE(capture.open(filename, 48000));
+        // Muted blocks are recorded as well, but not passed on to be heard
+        for (int i = 0; i < 20; i++) {
+            if (i % 3 == 0) {
+                capture.write_muted(block.data(), block.size());
+            } else {
+                capture.write(block.data(), block.size());
+            }
+        }
+        capture.close();
+        REQUIRE(capture.samples_written() == 10000);
+        REQUIRE(speaker.heard == 13 * block.size());
+
+        std::ifstream in(filename, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        size_t header = std::filesystem::path(name).extension() == ".wav" ? 44 : 0;
+        REQUIRE(bytes.size() == header + 20000);
+
+        if (header != 0) {
+            uint32_t rate = 0;
+            uint32_t data_size = 0;
+            std::memcpy(&rate, &bytes[24], 4);
+            std::memcpy(&data_size, &bytes[40], 4);
+            REQUIRE(std::string(bytes.data(), 4) == "RIFF");
+            REQUIRE(rate == 48000);
+            REQUIRE(data_size == 20000);
+        }
+
+        // The last block arrives whole and in order
+        int16_t sample = 0;
+        std::memcpy(&sample, &bytes[header + 19000 + 2 * 7], 2);
+        REQUIRE(sample == block[7]);
+    }
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,69 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "ay.hpp"
+#include "machine.hpp"
+
+TEST_CASE("AY tone generation", "[ay]") {
+    AY ay;
+    // Channel A at about 1kHz and full volume, everything else disabled
+    const uint8_t setup[][2] = {{0, 111}, {1, 0xf0}, {7, 0x3e}, {8, 15}};
+    for (const auto &[reg, value] : setup) {
+        ay.select(reg);
+        ay.write_data(value, 0);
+    }
+    ay.select(1);
+    REQUIRE(ay.read_data() == 0x00);  // Only the low nibble of the coarse period exists
+    ay.select(16);
+    REQUIRE(ay.read_data() == 0xff);
+
+    // A tenth of a second has about 100 rising edges
+    int edges = 0;
+    int16_t last = 0;
+    for (size_t i = 0; i < Beeper::default_sample_rate / 10 / 64; i++) {
+        std::vector<int16_t> block(64, 0);
+        ay.mix(block.data(), block.size());
+        for (int16_t sample : block) {
+            REQUIRE((sample == 0 || sample == 6000));
+            edges += (last == 0 && sample != 0);
+            last = sample;
+        }
+    }
+    REQUIRE(edges >= 95);
+    REQUIRE(edges <= 105);
+}
+
+TEST_CASE("AY sample mixing saturates", "[ay]") {
+    std::vector<int16_t> out(19, 32000);
+    std::vector<int16_t> in(19, 1000);
+    out[3] = -32000;
+    in[3] = -1000;
+    out[18] = 5;
+    mix_samples(out.data(), in.data(), out.size());
+    REQUIRE(out[0] == INT16_MAX);
+    REQUIRE(out[3] == INT16_MIN);
+    REQUIRE(out[17] == INT16_MAX);
+    REQUIRE(out[18] == 1005);
+}
+
+TEST_CASE("AY is mixed into 128K audio", "[ay]") {
+    Machine machine;
+    machine.set_model(SpectrumModel::ZX128K);
+
+    // ld bc,0xfffd; ld a,7; out (c),a; ld b,0xbf; ld a,0x3f; out (c),a: mixer all off, so channels are held high
+    // ld b,0xff; ld a,8; out (c),a; ld b,0xbf; ld a,15; out (c),a: channel A at full volume; jr $
+    const uint8_t program[] = {0x01, 0xfd, 0xff, 0x3e, 0x07, 0xed, 0x79, 0x06, 0xbf, 0x3e, 0x3f, 0xed, 0x79, 0x06,
+                               0xff, 0x3e, 0x08, 0xed, 0x79, 0x06, 0xbf, 0x3e, 0x0f, 0xed, 0x79, 0x18, 0xfe};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        machine.bus()[static_cast<uint16_t>(0x8000 + i)] = program[i];
+    }
+    machine.cpu().pc.set(0x8000);
+    REQUIRE(machine.run_frames(2) == 2);
+
+    REQUIRE(machine.bus().read_port(0xfffd) == 15);
+    std::vector<int16_t> audio(machine.audio_available());
+    REQUIRE(machine.read_audio(audio.data(), audio.size()) > 0);
+    REQUIRE(audio.back() == 6000);
+}
@@ -0,0 +1,89 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "batch.hpp"
+
+// 48K SNA whose code at 0x9000 increments every byte of display memory in turn, started through a return address
+// on the stack at 0x8000
+static std::vector<uint8_t> make_test_sna() {
+    std::vector<uint8_t> sna(27 + 49152, 0);
+    sna[0x17] = 0x00;  // SP = 0x8000
+    sna[0x18] = 0x80;
+    sna[0x19] = 1;  // IM 1
+
+    std::vector<uint8_t> code = {0x21, 0x00, 0x40, 0x34, 0x23, 0x7c, 0xfe, 0x5b, 0x20, 0xf9, 0x18, 0xf4};
+    std::copy(code.begin(), code.end(), sna.begin() + 27 + 0x9000 - 0x4000);
+    sna[27 + 0x8000 - 0x4000] = 0x00;  // Return address 0x9000
+    sna[27 + 0x8001 - 0x4000] = 0x90;
+    return sna;
+}
+
+TEST_CASE("Batch job list", "[batch]") {
+    std::istringstream list("# comment\n\ngame.z80\nother.sna 100\n");
+    std::vector<BatchJob> jobs;
+    REQUIRE(read_batch_jobs(list, 50, jobs));
+    REQUIRE(jobs.size() == 2);
+    REQUIRE(jobs[0].file == "game.z80");
+    REQUIRE(jobs[0].frames == 50);
+    REQUIRE(jobs[1].index == 1);
+    REQUIRE(jobs[1].frames == 100);
+
+    std::istringstream bad("game.z80 lots\n");
+    REQUIRE_FALSE(read_batch_jobs(bad, 50, jobs));
+    // Machines run at most UINT32_MAX frames at a time, larger counts are rejected rather than cut short
+    std::istringstream huge("game.z80 4294967296\n");
+    REQUIRE_FALSE(read_batch_jobs(huge, 50, jobs));
+    std::istringstream negative("game.z80 -1\n");
+    REQUIRE_FALSE(read_batch_jobs(negative, 50, jobs));
+}
+
+TEST_CASE("Batch result JSON", "[batch]") {
+    // Built in one go, assigning a short literal to a member string trips a false -Wmaybe-uninitialized in GCC 12
+    BatchResult result{.index = 3,
+                       .file = "a \"b\".sna",
+                       .status = "ok",
+                       .error = "",
+                       .frames = 10,
+                       .frame_hash = 0xabc,
+                       .ram_hash = 0,
+                       .pc = 0x1234,
+                       .milliseconds = 0.0};
+    REQUIRE(batch_result_json(result) ==
+            "{\"job\": 3, \"file\": \"a \\\"b\\\".sna\", \"status\": \"ok\", \"frames\": 10, \"frame_hash\": "
+            "\"0000000000000abc\", \"ram_hash\": \"0000000000000000\", \"pc\": \"0x1234\", \"ms\": 0.000}");
+}
+
+TEST_CASE("Batch runner", "[batch]") {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "jrnz_test_batch";
+    std::filesystem::create_directories(dir);
+    std::string sna_file = (dir / "test.sna").string();
+    std::vector<uint8_t> sna = make_test_sna();
+    std::ofstream(sna_file, std::ios::binary).write(reinterpret_cast<const char *>(sna.data()), sna.size());
+
+    std::vector<BatchJob> jobs;
+    for (size_t i = 0; i < 6; i++) {
+        jobs.push_back(BatchJob{i, (i == 4) ? (dir / "missing.sna").string() : sna_file, 5});
+    }
+
+    std::vector<uint8_t> rom;
+    BatchRunner runner(rom, 3);
+    std::vector<BatchResult> results(jobs.size());
+    runner.run(jobs, [&](const BatchResult &result) { results[result.index] = result; });
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (i == 4) {
+            REQUIRE(results[i].status == "error");
+            continue;
+        }
+        REQUIRE(results[i].status == "ok");
+        REQUIRE(results[i].frames == 5);
+        REQUIRE(results[i].frame_hash == results[0].frame_hash);
+        REQUIRE(results[i].ram_hash == results[0].ram_hash);
+    }
+
+    std::filesystem::remove_all(dir);
+}
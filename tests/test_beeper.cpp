@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "beeper.hpp"
+
+namespace {
+class RecordingAudio : public AudioSink {
+public:
+    void write(const int16_t *in, size_t count) override {
+        frames.emplace_back(in, in + count);
+    }
+    float fill() const override { return level; }
+
+    std::vector<std::vector<int16_t>> frames;
+    float level = {0.5f};
+};
+}  // namespace
+
+TEST_CASE("Beeper band-limited steps", "[beeper]") {
+    RecordingAudio audio;
+    Beeper beeper;
+    beeper.audio = &audio;
+    beeper.set_sample_rate(48000);
+
+    // EAR high half way through the first frame, low again in the second
+    beeper.write_port(35000, 0x10);
+    beeper.end_frame(70000);
+    beeper.write_port(100, 0x00);
+    beeper.end_frame(70000);
+    beeper.end_frame(70000);
+
+    // 70000 T-states at 3.5MHz are exactly 960 samples at 48kHz
+    REQUIRE(audio.frames.size() == 3);
+    REQUIRE(audio.frames[0].size() == 960);
+    REQUIRE(audio.frames[1].size() == 960);
+
+    // Silent before the step, settled at the EAR level once past it, and limited in overshoot around it
+    const std::vector<int16_t> &first = audio.frames[0];
+    REQUIRE(first[400] == 0);
+    REQUIRE(first[959] == 7840);
+    for (int16_t sample : first) {
+        REQUIRE(sample >= -800);
+        REQUIRE(sample <= 7840 + 800);
+    }
+    REQUIRE(audio.frames[1][0] == 7840);
+    REQUIRE(audio.frames[2][0] == 0);
+
+    // Border changes that leave EAR and MIC alone are not edges
+    beeper.write_port(10, 0x07);
+    beeper.end_frame(70000);
+    REQUIRE(audio.frames[3][0] == 0);
+}
+
+TEST_CASE("Beeper keeps the sample rate across frames", "[beeper]") {
+    RecordingAudio audio;
+    Beeper beeper;
+    beeper.audio = &audio;
+
+    size_t total = 0;
+    for (int i = 0; i < 50; i++) {
+        beeper.end_frame(69888);
+        total += audio.frames.back().size();
+    }
+    // A second of 48K frames, the fractions carried from frame to frame
+    REQUIRE(total == (uint64_t(69888) * 50 * Beeper::default_sample_rate) / Beeper::default_cpu_clock_hz);
+
+    // The 128K's longer frames at its faster clock
+    beeper.set_cpu_clock(3546900);
+    total = 0;
+    for (int i = 0; i < 50; i++) {
+        beeper.end_frame(70908);
+        total += audio.frames.back().size();
+    }
+    REQUIRE(total == (uint64_t(70908) * 50 * Beeper::default_sample_rate) / 3546900);
+}
+
+TEST_CASE("Beeper rate follows the sink's fill level", "[beeper]") {
+    RecordingAudio audio;
+    Beeper beeper;
+    beeper.audio = &audio;
+    beeper.set_sample_rate(48000);
+
+    // A full queue slows the output down, by no more than the largest skew
+    audio.level = 1.0f;
+    for (int i = 0; i < 100; i++) {
+        beeper.end_frame(70000);
+    }
+    REQUIRE(beeper.output_rate() < 48000);
+    REQUIRE(beeper.output_rate() >= 48000 * (1.0f - Beeper::max_rate_skew));
+    REQUIRE(audio.frames.back().size() < 960);
+
+    audio.level = 0.0f;
+    for (int i = 0; i < 100; i++) {
+        beeper.end_frame(70000);
+    }
+    REQUIRE(beeper.output_rate() > 48000);
+    REQUIRE(audio.frames.back().size() > 960);
+    REQUIRE(beeper.sample_rate() == 48000);
+}
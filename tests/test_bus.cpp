@@ -0,0 +1,68 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include "bus.hpp"
+#include "z80.hpp"
+
+namespace {
+class RecordingHook : public MemoryWriteHook {
+public:
+    void memory_written(uint16_t addr, uint8_t v) override { writes.emplace_back(addr, v); }
+    std::vector<std::pair<uint16_t, uint8_t>> writes;
+};
+}  // namespace
+
+TEST_CASE("ROM is protected on every write path", "[bus]") {
+    Bus mem(65536);
+    Z80 state(mem, true);
+    std::vector<uint8_t> rom(0x4000, 0x11);
+    REQUIRE(mem.load_rom(rom.data(), rom.size()));
+
+    // ld hl,0x0100; inc (hl); ld (0x3fff),hl; ld sp,0x0002; push hl; ld (0x8000),hl
+    const uint8_t program[] = {0x21, 0x00, 0x01, 0x34, 0x22, 0xff, 0x3f, 0x31,
+                               0x02, 0x00, 0xe5, 0x22, 0x00, 0x80};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        mem[0x8100 + i] = program[i];
+    }
+    state.pc.set(0x8100);
+    for (int i = 0; i < 6; i++) {
+        REQUIRE(state.clock());
+    }
+
+    REQUIRE(mem.read_data(0x0100) == 0x11);
+    REQUIRE(mem.read_data(0x0000) == 0x11);
+    REQUIRE(mem.read_data(0x0001) == 0x11);
+    REQUIRE(mem.read_data(0x3fff) == 0x11);
+    REQUIRE(mem.read_data(0x4000) == 0x01);  // The high byte of the straddling word is in RAM
+    REQUIRE(mem.read_addr_from_mem(0x8000) == 0x0100);
+}
+
+TEST_CASE("Write hooks see writes to their range", "[bus]") {
+    Bus mem(65536);
+    Z80 state(mem, true);
+    RecordingHook hook;
+    mem.add_write_hook(0x9000, 2, &hook);
+
+    // ld hl,0x9000; inc (hl); ld a,(hl); ld (0x9001),a; ld (0x9400),a; ld (hl),a
+    const uint8_t program[] = {0x21, 0x00, 0x90, 0x34, 0x7e, 0x32, 0x01, 0x90, 0x32, 0x00, 0x94, 0x77};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        mem[0x8000 + i] = program[i];
+    }
+    state.pc.set(0x8000);
+    for (int i = 0; i < 6; i++) {
+        REQUIRE(state.clock());
+    }
+
+    // Storing the value already there is still a write, reading the operand is not
+    REQUIRE(hook.writes.size() == 3);
+    REQUIRE(hook.writes[0] == std::make_pair<uint16_t, uint8_t>(0x9000, 1));
+    REQUIRE(hook.writes[1] == std::make_pair<uint16_t, uint8_t>(0x9001, 1));
+    REQUIRE(hook.writes[2] == std::make_pair<uint16_t, uint8_t>(0x9000, 1));
+    REQUIRE(mem.read_data(0x9400) == 1);
+
+    mem.remove_write_hook(&hook);
+    mem.write_data(0x9000, 5);
+    REQUIRE(hook.writes.size() == 3);
+    REQUIRE(mem.read_data(0x9000) == 5);
+}
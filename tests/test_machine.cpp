@@ -0,0 +1,248 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "frame_dump.hpp"
+#include "jrnz.h"
+#include "machine.hpp"
+
+// Increments every byte of display memory in turn, writing the high byte of the address to the border as it goes
+static const std::vector<uint8_t> test_rom = {
+    0x21, 0x00, 0x40,  // ld hl,0x4000
+    0x34,              // inc (hl)
+    0x23,              // inc hl
+    0x7c,              // ld a,h
+    0xd3, 0xfe,        // out (0xfe),a
+    0xfe, 0x5b,        // cp 0x5b
+    0x20, 0xf7,        // jr nz,0x0003
+    0x18, 0xf2,        // jr 0x0000
+};
+
+static uint64_t frame_hash(const Machine &machine) {
+    return FrameDumper::hash(machine.framebuffer(), ULA::frame_width * ULA::frame_height);
+}
+
+TEST_CASE("Machines run independently and deterministically", "[machine]") {
+    Machine first;
+    Machine second;
+    REQUIRE(first.load_rom(test_rom.data(), test_rom.size()));
+    REQUIRE(second.load_rom(test_rom.data(), test_rom.size()));
+
+    REQUIRE(first.run_frames(5) == 5);
+    REQUIRE(first.frames_completed() == 5);
+    REQUIRE(second.frames_completed() == 0);
+
+    REQUIRE(second.run_frames(5) == 5);
+    REQUIRE(frame_hash(first) == frame_hash(second));
+    REQUIRE(first.read_memory(0x4000) != 0);
+    REQUIRE(first.audio_available() > 0);
+}
+
+TEST_CASE("Machine state round trip", "[machine]") {
+    Machine machine;
+    REQUIRE(machine.load_rom(test_rom.data(), test_rom.size()));
+    machine.run_frames(3);
+    std::vector<uint8_t> state = machine.save_state();
+
+    machine.run_frames(4);
+    uint64_t expected = frame_hash(machine);
+    std::vector<uint8_t> expected_screen(6912);
+    machine.read_memory(0x4000, expected_screen.data(), expected_screen.size());
+
+    // Restoring into the same machine and into a fresh one both replay the same frames
+    REQUIRE(machine.restore_state(state.data(), state.size()));
+    REQUIRE(machine.frames_completed() == 3);
+    machine.run_frames(4);
+    REQUIRE(frame_hash(machine) == expected);
+
+    Machine restored;
+    REQUIRE(restored.restore_state(state.data(), state.size()));
+    restored.run_frames(4);
+    REQUIRE(frame_hash(restored) == expected);
+    std::vector<uint8_t> screen(6912);
+    restored.read_memory(0x4000, screen.data(), screen.size());
+    REQUIRE(screen == expected_screen);
+
+    // A state the program saved itself can skip the scratch machine
+    Machine trusted;
+    REQUIRE(trusted.restore_trusted_state(state.data(), state.size()));
+    trusted.run_frames(4);
+    REQUIRE(frame_hash(trusted) == expected);
+
+    // Damaged states are rejected without touching the machine
+    REQUIRE_FALSE(restored.restore_state(state.data(), state.size() - 1));
+    state[0] ^= 0xff;
+    REQUIRE_FALSE(restored.restore_state(state.data(), state.size()));
+    REQUIRE(restored.frames_completed() == 7);
+
+    // A field out of range is found after earlier parts have loaded, the machine is still left as it was. The last
+    // field is the count of sound chip samples already made for the frame.
+    state[0] ^= 0xff;
+    std::fill(state.end() - sizeof(size_t), state.end(), 0xff);
+    REQUIRE_FALSE(restored.restore_state(state.data(), state.size()));
+    REQUIRE(restored.frames_completed() == 7);
+    REQUIRE(frame_hash(restored) == expected);
+    REQUIRE_FALSE(trusted.restore_trusted_state(state.data(), state.size()));
+}
+
+TEST_CASE("Forked machines share memory until written", "[machine]") {
+    Machine parent;
+    REQUIRE(parent.load_rom(test_rom.data(), test_rom.size()));
+    parent.run_frames(3);
+
+    // A fork carries on exactly as the parent would
+    std::unique_ptr<Machine> child = parent.fork();
+    REQUIRE(child->frames_completed() == 3);
+    REQUIRE(frame_hash(*child) == frame_hash(parent));
+    REQUIRE(child->memory_hash() == parent.memory_hash());
+
+    child->run_frames(4);
+    parent.run_frames(4);
+    REQUIRE(frame_hash(*child) == frame_hash(parent));
+    REQUIRE(child->memory_hash() == parent.memory_hash());
+
+    // Writes stay on their own side
+    uint8_t value = parent.read_memory(0x8000);
+    child->bus().write_data(0x8000, static_cast<uint8_t>(value + 1));
+    REQUIRE(parent.read_memory(0x8000) == value);
+    parent.bus().write_data(0x9000, 0x55);
+    REQUIRE(child->read_memory(0x9000) == 0);
+
+    // A word written across a page boundary lands in both pages
+    static const std::vector<uint8_t> word_rom = {
+        0x21, 0x34, 0x12,  // ld hl,0x1234
+        0x22, 0xff, 0x83,  // ld (0x83ff),hl
+        0x76,              // halt
+    };
+    Machine machine;
+    REQUIRE(machine.load_rom(word_rom.data(), word_rom.size()));
+    std::unique_ptr<Machine> word_child = machine.fork();
+    word_child->run_frames(1);
+    REQUIRE(word_child->read_memory(0x83ff) == 0x34);
+    REQUIRE(word_child->read_memory(0x8400) == 0x12);
+    REQUIRE(machine.read_memory(0x83ff) == 0);
+}
+
+TEST_CASE("Machines on separate threads", "[machine]") {
+    Machine reference;
+    reference.load_rom(test_rom.data(), test_rom.size());
+    reference.run_frames(10);
+    uint64_t expected = frame_hash(reference);
+
+    std::vector<uint64_t> hashes(4, 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < hashes.size(); i++) {
+        threads.emplace_back([&hashes, i]() {
+            Machine machine;
+            machine.load_rom(test_rom.data(), test_rom.size());
+            machine.run_frames(10);
+            hashes[i] = frame_hash(machine);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (uint64_t hash : hashes) {
+        REQUIRE(hash == expected);
+    }
+}
+
+TEST_CASE("C interface", "[machine]") {
+    jrnz_machine *machine = jrnz_create();
+    REQUIRE(machine != nullptr);
+    REQUIRE(jrnz_load_rom(machine, test_rom.data(), test_rom.size()) == 0);
+    REQUIRE(jrnz_run_frames(machine, 2) == 2);
+
+    int width = 0;
+    int height = 0;
+    REQUIRE(jrnz_framebuffer(machine, &width, &height) != nullptr);
+    REQUIRE(width == ULA::frame_width);
+    REQUIRE(height == ULA::frame_height);
+
+    size_t size = jrnz_save_state(machine, nullptr, 0);
+    std::vector<uint8_t> state(size);
+    REQUIRE(jrnz_save_state(machine, state.data(), state.size()) == size);
+    REQUIRE(jrnz_restore_state(machine, state.data(), state.size()) == 0);
+    REQUIRE(jrnz_load_sna(machine, state.data(), 10) == -1);
+
+    std::vector<int16_t> audio(1024);
+    REQUIRE(jrnz_read_audio(machine, audio.data(), audio.size()) == 0);  // Restoring drops buffered samples
+
+    jrnz_destroy(machine);
+}
+
+TEST_CASE("128K paging and snapshots", "[machine]") {
+    // Version 3 Z80 snapshot of a 128K with interrupts off, running code in bank 2 at 0x8000
+    std::vector<uint8_t> image(30 + 2 + 54, 0);
+    image[8] = 0x00;  // SP 0x8100
+    image[9] = 0x81;
+    image[12] = 0x00;
+    image[30] = 54;
+    image[32] = 0x00;  // PC 0x8000
+    image[33] = 0x80;
+    image[34] = 4;  // 128K
+    image[38] = 7;  // Sound chip register 7 selected, with the mixer and channel A's volume set
+    image[39 + 7] = 0x3e;
+    image[39 + 8] = 0x0f;
+
+    const std::vector<uint8_t> program = {
+        0x01, 0xfd, 0x7f,  // ld bc,0x7ffd
+        0x3e, 0x03,        // ld a,3
+        0xed, 0x79,        // out (c),a
+        0x3a, 0x00, 0xc0,  // ld a,(0xc000)
+        0x32, 0x00, 0x90,  // ld (0x9000),a
+        0x3e, 0x0c,        // ld a,0x0c
+        0xed, 0x79,        // out (c),a
+        0x3a, 0x00, 0xc0,  // ld a,(0xc000)
+        0x32, 0x01, 0x90,  // ld (0x9001),a
+        0x76,              // halt
+    };
+    for (uint8_t bank = 0; bank < 8; bank++) {
+        std::vector<uint8_t> data(0x4000, 0);
+        data[0] = static_cast<uint8_t>(0x11 * bank);
+        if (bank == 2) {
+            std::copy(program.begin(), program.end(), data.begin());
+        }
+        if (bank == 7) {
+            std::fill(data.begin() + 0x1800, data.begin() + 0x1b00, 0x38);  // White paper on the shadow screen
+        }
+        image.push_back(0xff);  // Uncompressed
+        image.push_back(0xff);
+        image.push_back(static_cast<uint8_t>(bank + 3));
+        image.insert(image.end(), data.begin(), data.end());
+    }
+
+    Machine small;
+    REQUIRE_FALSE(small.load_z80(image.data(), image.size()));
+
+    Machine machine;
+    machine.set_model(SpectrumModel::ZX128K);
+    REQUIRE(machine.load_z80(image.data(), image.size()));
+    REQUIRE(machine.read_memory(0xc000) == 0x00);
+    REQUIRE(machine.bus().read_port(0xfffd) == 0x3e);
+    machine.bus().write_port(0xfffd, 8);
+    REQUIRE(machine.bus().read_port(0xfffd) == 0x0f);
+    REQUIRE(machine.run_frames(1) == 1);
+
+    REQUIRE(machine.bus().paging() == 0x0c);
+    REQUIRE(machine.read_memory(0x9000) == 0x33);
+    REQUIRE(machine.read_memory(0x9001) == 0x44);
+    REQUIRE(machine.read_memory(0xc000) == 0x44);
+
+    // The shadow screen is shown
+    const uint32_t *pixels = machine.framebuffer();
+    REQUIRE(pixels[ULA::border_size * ULA::frame_width + ULA::border_size] != pixels[0]);
+
+    // Paging survives a state round trip and a fork
+    std::vector<uint8_t> state = machine.save_state();
+    Machine restored;
+    REQUIRE(restored.restore_state(state.data(), state.size()));
+    REQUIRE(restored.model() == SpectrumModel::ZX128K);
+    REQUIRE(restored.read_memory(0xc000) == 0x44);
+    std::unique_ptr<Machine> child = machine.fork();
+    REQUIRE(child->bus().paging() == 0x0c);
+    REQUIRE(child->read_memory(0xc000) == 0x44);
+}
@@ -0,0 +1,156 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "bus.hpp"
+#include "call_profiler.hpp"
+#include "hotspot_profiler.hpp"
+#include "opcode_profiler.hpp"
+#include "symbols.hpp"
+#include "z80.hpp"
+
+TEST_CASE("Opcode profiler", "[profiler]") {
+    Bus mem(65536);
+    Z80 state(mem, true);
+    OpcodeProfiler profiler;
+    state.opcode_profiler = &profiler;
+
+    // nop; ld a,5; rlc a; ld ix,0x8000; nop
+    const uint8_t program[] = {0x00, 0x3e, 0x05, 0xcb, 0x07, 0xdd, 0x21, 0x00, 0x80, 0x00};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        mem[i] = program[i];
+    }
+
+    for (int i = 0; i < 5; i++) {
+        REQUIRE(state.clock());
+    }
+
+    REQUIRE(profiler.entry(0x00).count == 2);
+    REQUIRE(profiler.entry(0x00).cycles == 8);
+    REQUIRE(profiler.entry(0x3e).count == 1);
+    REQUIRE(profiler.entry(0x3e).cycles == 7);
+    REQUIRE(profiler.entry(0xcb07).count == 1);
+    REQUIRE(profiler.entry(0xcb07).cycles == 8);
+    REQUIRE(profiler.entry(0xdd21).count == 1);
+    REQUIRE(profiler.entry(0xdd21).cycles == 14);
+    REQUIRE(profiler.entry(0xed07).count == 0);
+
+    std::stringstream csv;
+    profiler.dump_csv(csv);
+    REQUIRE(csv.str().find("dd,0xdd21,\"ld ix,**\",1,14") != std::string::npos);
+
+    // Disabled profiling must leave the counters untouched
+    profiler.enabled = false;
+    mem[10] = 0x00;
+    REQUIRE(state.clock());
+    REQUIRE(profiler.entry(0x00).count == 2);
+}
+
+TEST_CASE("Hotspot profiler", "[profiler]") {
+    Bus mem(65536);
+    Z80 state(mem, true);
+    HotspotProfiler profiler;
+    state.hotspot_profiler = &profiler;
+
+    // 0x8000: ld b,3; 0x8002: djnz 0x8002; 0x8004: halt
+    const uint8_t program[] = {0x06, 0x03, 0x10, 0xfe, 0x76};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        mem[0x8000 + i] = program[i];
+    }
+    state.pc.set(0x8000);
+
+    for (int i = 0; i < 6; i++) {
+        REQUIRE(state.clock());
+    }
+
+    REQUIRE(profiler.entry(0x8000).count == 1);
+    REQUIRE(profiler.entry(0x8002).count == 3);
+    REQUIRE(profiler.entry(0x8002).cycles == 13 + 13 + 8);
+    // Time spent halted is attributed to the halt instruction
+    REQUIRE(profiler.entry(0x8004).count == 2);
+
+    SymbolTable symbols;
+    symbols.add(0x8000, "main");
+    symbols.add(0x8004, "idle");
+
+    uint16_t base = 0;
+    std::string name;
+    REQUIRE(symbols.find_routine(0x8002, base, name));
+    REQUIRE(base == 0x8000);
+    REQUIRE(name == "main");
+    REQUIRE(symbols.describe(0x8002) == "main+2");
+    REQUIRE(symbols.describe(0x0010) == "PRINT-A-1");
+    // ROM labels must not absorb RAM addresses below the first user symbol
+    REQUIRE(!symbols.find_routine(0x7fff, base, name));
+
+    std::stringstream report;
+    profiler.report(report, symbols);
+    REQUIRE(report.str().find("main") < report.str().find("idle"));
+}
+
+TEST_CASE("Symbol files with names that look like addresses", "[profiler]") {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "jrnz_test_symbols";
+    std::filesystem::create_directories(dir);
+    std::string filename = (dir / "labels.sym").string();
+    {
+        std::ofstream out(filename);
+        out << "; labels\n"
+            << "8000 start\n"
+            << "fade = $8010\n"
+            << "add EQU 8020h\n"
+            << "beef: equ 0x8030\n"
+            << "cafe 8040\n"
+            << "dead #8050\n"
+            << "bad = nowhere\n";
+    }
+
+    SymbolTable symbols(false);
+    REQUIRE(symbols.load(filename));
+    REQUIRE(symbols.size() == 6);
+    REQUIRE(symbols.describe(0x8000) == "start");
+    REQUIRE(symbols.describe(0x8010) == "fade");
+    REQUIRE(symbols.describe(0x8020) == "add");
+    REQUIRE(symbols.describe(0x8030) == "beef");
+    REQUIRE(symbols.describe(0x8040) == "cafe");
+    REQUIRE(symbols.describe(0x8050) == "dead");
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Call profiler", "[profiler]") {
+    Bus mem(65536);
+    Z80 state(mem, true);
+    CallProfiler profiler;
+    state.call_profiler = &profiler;
+
+    const std::vector<std::pair<uint16_t, std::vector<uint8_t>>> program = {
+        {0x8000, {0xcd, 0x10, 0x80, 0xcd, 0x20, 0x80, 0xcd, 0x30, 0x80, 0x76}},  // call 3 routines; halt
+        {0x8010, {0xcd, 0x20, 0x80, 0xc9}},                                      // call 0x8020; ret
+        {0x8020, {0x00, 0xc9}},                                                  // nop; ret
+        {0x8030, {0xe1, 0xe9}},                                                  // pop hl; jp (hl)
+    };
+    for (const auto &[addr, bytes] : program) {
+        for (size_t i = 0; i < bytes.size(); i++) {
+            mem[addr + i] = bytes[i];
+        }
+    }
+    state.pc.set(0x8000);
+    state.sp.set(0xff00);
+
+    for (int i = 0; i < 13; i++) {
+        REQUIRE(state.clock());
+    }
+
+    // The routine at 0x8030 never returns but dropping its return address must still unwind it
+    REQUIRE(profiler.depth() == 0);
+    REQUIRE(state.pc.get() == 0x800a);
+
+    std::stringstream folded;
+    profiler.write_folded(folded, SymbolTable());
+    const std::string out = folded.str();
+    REQUIRE(out.find("[top];0x8010;0x8020 14\n") != std::string::npos);
+    REQUIRE(out.find("[top];0x8010 27\n") != std::string::npos);
+    REQUIRE(out.find("[top];0x8020 14\n") != std::string::npos);
+    REQUIRE(out.find("[top];0x8030 10\n") != std::string::npos);
+}
@@ -0,0 +1,71 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "sample_ring.hpp"
+
+TEST_CASE("Sample ring overruns and underruns", "[sample_ring]") {
+    SampleRing ring(6);
+    REQUIRE(ring.capacity() == 8);
+
+    std::vector<int16_t> in = {1, 2, 3, 4, 5};
+    std::vector<int16_t> out(8, 0);
+    REQUIRE(ring.write(in.data(), in.size()) == 5);
+    REQUIRE(ring.read(out.data(), 3) == 3);
+    REQUIRE(out[2] == 3);
+
+    // Wraps around the end, the last sample does not fit
+    in = {6, 7, 8, 9, 10, 11, 12};
+    REQUIRE(ring.write(in.data(), in.size()) == 6);
+    REQUIRE(ring.overruns() == 1);
+    REQUIRE(ring.available() == 8);
+
+    REQUIRE(ring.read(out.data(), 8) == 8);
+    REQUIRE(out[0] == 4);
+    REQUIRE(out[7] == 11);
+    REQUIRE(ring.underruns() == 0);
+    REQUIRE(ring.read(out.data(), 1) == 0);
+    REQUIRE(ring.underruns() == 1);
+}
+
+TEST_CASE("Sample ring across threads", "[sample_ring]") {
+    SampleRing ring(256);
+    std::atomic<bool> done = {false};
+
+    std::thread producer([&]() {
+        int16_t next = 0;
+        while (next < 20000) {
+            int16_t block[37];
+            for (int16_t &sample : block) {
+                sample = next++;
+            }
+            // Retry what did not fit so every sample is delivered
+            size_t sent = 0;
+            while (sent < 37) {
+                sent += ring.write(block + sent, 37 - sent);
+            }
+        }
+        done = true;
+    });
+
+    // Samples must arrive complete and in order
+    int16_t expected = 0;
+    bool ordered = true;
+    int16_t out[50];
+    for (;;) {
+        bool finished = done;
+        size_t count = ring.read(out, 50);
+        for (size_t i = 0; i < count; i++) {
+            ordered &= (out[i] == expected++);
+        }
+        if (count == 0 && finished) {
+            break;
+        }
+    }
+    producer.join();
+
+    REQUIRE(ordered);
+    REQUIRE(expected >= 20000);
+}
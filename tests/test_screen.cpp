@@ -0,0 +1,174 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <vector>
+
+#include "bus.hpp"
+#include "frame_dump.hpp"
+#include "screen.hpp"
+#include "ula.hpp"
+#include "z80.hpp"
+
+TEST_CASE("Screen line addresses", "[screen]") {
+    REQUIRE(screen_line_offsets[0] == 0x0000);
+    REQUIRE(screen_line_offsets[1] == 0x0100);
+    REQUIRE(screen_line_offsets[8] == 0x0020);
+    REQUIRE(screen_line_offsets[64] == 0x0800);
+    REQUIRE(screen_line_offsets[191] == 0x17e0);
+}
+
+TEST_CASE("Screen expansion", "[screen]") {
+    std::vector<uint8_t> display(6912, 0);
+    std::vector<uint32_t> out(256 * 192, 0);
+
+    // Top left cell is bright white ink on black paper and flashing
+    display[0x0000] = 0x81;
+    display[0x1800] = 0xc7;
+    expand_screen(ScreenKernel::Scalar, display.data(), false, out.data(), 256);
+    REQUIRE(out[0] == 0xffffffff);
+    REQUIRE(out[1] == 0xff000000);
+    REQUIRE(out[7] == 0xffffffff);
+
+    expand_screen(ScreenKernel::Scalar, display.data(), true, out.data(), 256);
+    REQUIRE(out[0] == 0xff000000);
+    REQUIRE(out[1] == 0xffffffff);
+}
+
+TEST_CASE("Screen kernels match scalar", "[screen]") {
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> display(6912);
+    for (auto &byte : display) {
+        byte = static_cast<uint8_t>(rng());
+    }
+
+    for (bool invert : {false, true}) {
+        std::vector<uint32_t> expected(256 * 192);
+        expand_screen(ScreenKernel::Scalar, display.data(), invert, expected.data(), 256);
+
+        for (ScreenKernel kernel : {ScreenKernel::SSE2, ScreenKernel::AVX2}) {
+            if (!screen_kernel_supported(kernel)) {
+                continue;
+            }
+            std::vector<uint32_t> actual(256 * 192);
+            expand_screen(kernel, display.data(), invert, actual.data(), 256);
+            INFO(screen_kernel_name(kernel));
+            REQUIRE(actual == expected);
+        }
+    }
+}
+
+TEST_CASE("Screen dirty cells", "[screen]") {
+    Bus mem(65536);
+    Z80 state(mem, true);
+    auto &dirty = mem.screen_dirty_rows();
+    REQUIRE(dirty[0] == 0xffffffff);
+    dirty.fill(0);
+
+    // ld hl,0x48a3; ld (hl),a; ld (0x5aff),a
+    const uint8_t program[] = {0x21, 0xa3, 0x48, 0x77, 0x32, 0xff, 0x5a};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        mem[0x8000 + i] = program[i];
+    }
+    state.pc.set(0x8000);
+
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(state.clock());
+    }
+
+    // 0x48a3 is in the middle third, character row 5, column 3
+    REQUIRE(dirty[13] == (1u << 3));
+    REQUIRE(dirty[23] == (1u << 31));
+    for (int row = 0; row < 24; row++) {
+        if (row != 13 && row != 23) {
+            REQUIRE(dirty[row] == 0);
+        }
+    }
+}
+
+TEST_CASE("Screen write log", "[screen]") {
+    Bus mem(65536);
+    Z80 state(mem, true);
+
+    // ld hl,0x5800; ld (hl),0x38; out (0xfe),a; inc (hl)
+    const uint8_t program[] = {0x21, 0x00, 0x58, 0x36, 0x38, 0xd3, 0xfe, 0x34};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        mem[0x8000 + i] = program[i];
+    }
+    state.pc.set(0x8000);
+    state.af.set(0x0200);
+
+    for (uint32_t t = 0; t < 4; t++) {
+        mem.frame_tstate = 100 + t * 10;
+        REQUIRE(state.clock());
+    }
+    mem.resolve_screen_log();
+
+    const auto &log = mem.screen_log();
+    REQUIRE(log.size() == 3);
+    REQUIRE(log[0].tstate == 110);
+    REQUIRE(log[0].offset == 0x1800);
+    REQUIRE(log[0].value == 0x38);
+    REQUIRE(log[1].is_border);
+    REQUIRE(log[1].value == 0x02);
+    REQUIRE(log[2].tstate == 130);
+    REQUIRE(log[2].value == 0x39);
+}
+
+TEST_CASE("Frame hash", "[screen]") {
+    // FNV-1a over the RGB bytes, alpha is ignored
+    const uint32_t pixels[] = {0xff123456};
+    REQUIRE(FrameDumper::hash(pixels, 0) == 0xcbf29ce484222325);
+    REQUIRE(FrameDumper::hash(pixels, 1) == 0x7486b218c3c86edf);
+
+    const uint32_t no_alpha[] = {0x00123456};
+    REQUIRE(FrameDumper::hash(no_alpha, 1) == FrameDumper::hash(pixels, 1));
+}
+
+namespace {
+class CountingSink : public VideoSink {
+public:
+    void frame(const uint32_t *pixels, bool changed) override {
+        (void)pixels;
+        (void)changed;
+        frames++;
+    }
+    int frames = {0};
+};
+}  // namespace
+
+TEST_CASE("Frames skipped faster than real time", "[screen]") {
+    Bus mem(65536);
+    Z80 state(mem, true);
+    ULA ula(state, mem, true);
+    CountingSink sink;
+    CountingSink recorder;
+    ula.add_video_sink(&sink);
+    ula.add_recording_sink(&recorder);
+
+    bool do_exit = false;
+    bool do_break = false;
+    auto run_frames = [&](int count) {
+        for (uint64_t target = ula.frames_completed() + count; ula.frames_completed() < target;) {
+            ula.clock(do_exit, do_break);
+        }
+    };
+
+    ula.speed = 4;
+    run_frames(8);
+    REQUIRE(sink.frames == 2);
+    REQUIRE(recorder.frames == 8);
+    REQUIRE(ula.warping());
+
+    // Parked in the ROM loader's edge loop, auto warp renders one frame in ten until well after it leaves
+    ula.speed = 1;
+    ula.auto_warp = true;
+    state.pc.set(0x05e7);
+    sink.frames = 0;
+    run_frames(20);
+    REQUIRE(sink.frames == 2);
+    state.pc.set(0x8000);
+    run_frames(20);
+    REQUIRE(ula.warping());
+    run_frames(10);
+    REQUIRE_FALSE(ula.warping());
+}
@@ -0,0 +1,62 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "server.hpp"
+
+TEST_CASE("Job server requests", "[server]") {
+    std::vector<uint8_t> rom;
+    JobServer server(rom);
+
+    REQUIRE(server.handle_request("ping") == "{\"status\": \"ok\"}");
+    REQUIRE(server.handle_request("").find("\"error\": \"empty request\"") != std::string::npos);
+    REQUIRE(server.handle_request("fly").find("\"status\": \"error\"") != std::string::npos);
+    REQUIRE(server.handle_request("run frames").find("key=value") != std::string::npos);
+    REQUIRE(server.handle_request("run file=/nonexistent/x.sna").find("unable to open file") != std::string::npos);
+}
+
+TEST_CASE("Job server runs snapshots", "[server]") {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "jrnz_test_server";
+    std::filesystem::create_directories(dir);
+    std::string sna_file = (dir / "test.sna").string();
+
+    // Code at 0x9000 stores 0x2a at 0x8100 and halts, started through a return address on the stack at 0x8000
+    std::vector<uint8_t> sna(27 + 49152, 0);
+    sna[0x18] = 0x80;
+    std::vector<uint8_t> code = {0x3e, 0x2a, 0x32, 0x00, 0x81, 0x76};
+    std::copy(code.begin(), code.end(), sna.begin() + 27 + 0x5000);
+    sna[27 + 0x4001] = 0x90;
+    std::ofstream(sna_file, std::ios::binary).write(reinterpret_cast<const char *>(sna.data()), sna.size());
+
+    std::vector<uint8_t> rom;
+    JobServer server(rom);
+    std::string request = "run file=" + sna_file + " frames=2 keys=0:1 ram=0x8100:2";
+    std::string first = server.handle_request(request);
+    REQUIRE(first.find("\"status\": \"ok\"") != std::string::npos);
+    REQUIRE(first.find("\"frames\": 2") != std::string::npos);
+    REQUIRE(first.find("\"ram\": \"2a00\"") != std::string::npos);
+
+    // The second run comes from the cached snapshot and a reused machine and gives the same answer
+    std::string second = server.handle_request(request);
+    REQUIRE(second.substr(0, second.find("\"ms\"")) == first.substr(0, first.find("\"ms\"")));
+    REQUIRE(server.handle_request("stats").find("\"cache_hits\": 1") != std::string::npos);
+
+    REQUIRE(server.handle_request("run file=" + sna_file + " keys=9:1").find("rows 0-7") != std::string::npos);
+    for (const char *frames : {"frames=ten", "frames=-1", "frames=4294967296", "hold=2x"}) {
+        std::string response = server.handle_request("run file=" + sna_file + " " + frames);
+        REQUIRE(response.find("frames and hold") != std::string::npos);
+    }
+
+    // Screenshots only go to the server's directory
+    std::string screenshot = "run file=" + sna_file + " frames=1 screenshot=";
+    REQUIRE(server.handle_request(screenshot + "last.ppm").find("disabled") != std::string::npos);
+    server.screenshot_dir = dir.string();
+    REQUIRE(server.handle_request(screenshot + "../last.ppm").find("without a directory") != std::string::npos);
+    REQUIRE(server.handle_request(screenshot + "last.ppm").find("\"status\": \"ok\"") != std::string::npos);
+    REQUIRE(std::filesystem::exists(dir / "last.ppm"));
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,62 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+
+#include "triple_buffer.hpp"
+
+TEST_CASE("Triple buffer hand over", "[triple_buffer]") {
+    TripleBuffer frames(4);
+    REQUIRE_FALSE(frames.acquire());
+
+    frames.back()[0] = 1;
+    REQUIRE_FALSE(frames.publish());
+    REQUIRE(frames.acquire());
+    REQUIRE(frames.front()[0] == 1);
+    REQUIRE_FALSE(frames.acquire());
+
+    // An unconsumed frame is replaced by the newer one
+    frames.back()[0] = 2;
+    REQUIRE_FALSE(frames.publish());
+    frames.back()[0] = 3;
+    REQUIRE(frames.publish());
+    REQUIRE(frames.acquire());
+    REQUIRE(frames.front()[0] == 3);
+}
+
+TEST_CASE("Triple buffer across threads", "[triple_buffer]") {
+    TripleBuffer frames(256);
+    std::atomic<bool> done = {false};
+
+    std::thread producer([&]() {
+        for (uint32_t n = 1; n <= 20000; n++) {
+            uint32_t *buffer = frames.back();
+            for (size_t i = 0; i < 256; i++) {
+                buffer[i] = n;
+            }
+            frames.publish();
+        }
+        done = true;
+    });
+
+    // Frames must arrive whole and in order, although some may be skipped
+    uint32_t last = 0;
+    bool torn = false;
+    for (;;) {
+        bool finished = done;
+        if (frames.acquire()) {
+            const uint32_t *buffer = frames.front();
+            for (size_t i = 0; i < 256; i++) {
+                torn |= (buffer[i] != buffer[0]);
+            }
+            torn |= (buffer[0] <= last);
+            last = buffer[0];
+        } else if (finished) {
+            break;
+        }
+    }
+    producer.join();
+
+    REQUIRE_FALSE(torn);
+    REQUIRE(last == 20000);
+}
@@ -0,0 +1,49 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "video_capture.hpp"
+
+TEST_CASE("Video capture writes a y4m stream", "[video_capture]") {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "jrnz_test_video_capture";
+    std::filesystem::create_directories(dir);
+    std::string filename = (dir / "out.y4m").string();
+
+    // White on the left half, black on the right
+    std::vector<uint32_t> pixels(8 * 4, 0xff000000);
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            pixels[y * 8 + x] = 0xffffffff;
+        }
+    }
+
+    VideoCapture capture(8, 4);
+    REQUIRE(capture.open(filename, 2));
+    for (int i = 0; i < 5; i++) {
+        capture.frame(pixels.data(), true);
+    }
+    capture.close();
+    // Three frames fit the queue, so none are dropped
+    REQUIRE(capture.frames_written() == 3);
+    REQUIRE(capture.frames_dropped() == 0);
+
+    std::ifstream in(filename, std::ios::binary);
+    std::string stream((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string header = "YUV4MPEG2 W8 H4 F50:2 Ip A1:1 C420jpeg\n";
+    REQUIRE(stream.substr(0, header.size()) == header);
+
+    // Every other frame, each a Y plane and quarter size U and V planes
+    size_t frame_size = 6 + 8 * 4 * 3 / 2;
+    REQUIRE(stream.size() == header.size() + 3 * frame_size);
+    std::string frame = stream.substr(header.size(), frame_size);
+    REQUIRE(frame.substr(0, 6) == "FRAME\n");
+    REQUIRE(static_cast<uint8_t>(frame[6]) == 235);
+    REQUIRE(static_cast<uint8_t>(frame[6 + 7]) == 16);
+    REQUIRE(static_cast<uint8_t>(frame[6 + 32]) == 128);
+
+    std::filesystem::remove_all(dir);
+}